@@ -1,14 +1,29 @@
-#include <assert.h>
+#include <csignal>
 #include <fcntl.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/timerfd.h>
+#include <sys/un.h>
 #include <termios.h>
 #include <unistd.h>
 
 #include <chrono>
+#include <cstdio>
+#include <cstdlib>
 #include <iostream>
 #include <memory>
-#include <random>
+#include <string>
 #include <vector>
 
+#include "tetris_engine.h"
+#include "tetris_lockstep.h"
+#include "tetris_perf.h"
+#include "tetris_trace.h"
+#include "tetris_render.h"
+#include "tetris_replay.h"
+#include "tetris_snapshot.h"
+#include "tetris_versus.h"
+
 class NonblockTerm {
 public:
     NonblockTerm() {
@@ -40,508 +55,668 @@ private:
     struct termios m_default_term;
 };
 
-class FpsStabler {
+class TetrisApp {
 public:
-    FpsStabler(double fps)
-        : INTERVAL_US(1000.0 * 1000.0 / fps),
-          m_prev_time(std ::chrono::system_clock::now()) {}
-
-    void sleep() {
-        const auto curr_time = std::chrono::system_clock::now();
-        const double elapsed_us =
-            std::chrono::duration_cast<std::chrono::microseconds>(curr_time -
-                                                                  m_prev_time)
-                .count();
-        m_prev_time = curr_time;
-        const double sleep_us = INTERVAL_US - elapsed_us;
-        if (0.0 < sleep_us) {
-            usleep(sleep_us);
+    TetrisApp(size_t w, size_t h, double event_fps = 1.0,
+              const std::string& record_path = "",
+              const std::string& snapshot_path = "")
+        : m_engine(w, h),
+          m_renderer(w, h),
+          m_snapshot_path(snapshot_path),
+          EVENT_INTERVAL_NS(
+              static_cast<long>(1000.0 * 1000.0 * 1000.0 / event_fps)) {
+        // Resume instantly from an existing snapshot of the same field size
+        if (!snapshot_path.empty()) {
+            uint64_t phase_ns = 0;
+            auto resumed = LoadSnapshot(snapshot_path, &phase_ns);
+            if (resumed && resumed->getBlockMap().width() == w &&
+                resumed->getBlockMap().height() == h) {
+                m_engine = std::move(*resumed);
+                m_resume_phase_ns = phase_ns;
+            }
         }
-    }
-
-private:
-    const double INTERVAL_US;
-    std::chrono::system_clock::time_point m_prev_time;
-};
-
-class EventClock {
-public:
-    EventClock(double fps)
-        : INTERVAL_US(1000.0 * 1000.0 / fps),
-          m_prev_time(std ::chrono::system_clock::now()),
-          m_prev_rest(0.0) {}
-
-    bool shouldHappen() {
-        const auto curr_time = std::chrono::system_clock::now();
-        const double elapsed_us =
-            std::chrono::duration_cast<std::chrono::microseconds>(curr_time -
-                                                                  m_prev_time)
-                .count();
-        const double curr_rest = (elapsed_us + m_prev_rest) - INTERVAL_US;
-        if (0.0 < curr_rest) {
-            m_prev_time = curr_time;
-            m_prev_rest = curr_rest;
-            return true;
-        } else {
-            return false;
+        if (!record_path.empty()) {
+            m_replay_writer = std::make_unique<ReplayWriter>(
+                record_path, w, h, m_engine.getSeed());
         }
+        // Frames go out on a background thread so a stalled terminal (e.g.
+        // a saturated SSH link) never backpressures gravity or input
+        m_renderer.enableAsyncWrites();
+        m_start_time = std::chrono::steady_clock::now();
     }
 
-private:
-    const double INTERVAL_US;
-    std::chrono::system_clock::time_point m_prev_time;
-    double m_prev_rest;
-};
+    void run() {
+        // First frame before anything else: the chrome is precomposed and
+        // the writer thread owns the write, so pixels head for the terminal
+        // while the slower setup below (the raw-mode termios round-trip,
+        // timer arming) is still running
+        drawFrame();
+
+        // Raw-mode terminal, deferred off the first-frame path
+        m_nonblock_term = std::make_unique<NonblockTerm>();
+
+        // Gravity ticks come from a timerfd so the process sleeps in the
+        // kernel (via poll) until either a key arrives or a tick is due,
+        // instead of spinning at the frame rate.
+        const int timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        struct itimerspec timer_spec;
+        timer_spec.it_interval.tv_sec = EVENT_INTERVAL_NS / 1000000000L;
+        timer_spec.it_interval.tv_nsec = EVENT_INTERVAL_NS % 1000000000L;
+        timer_spec.it_value = timer_spec.it_interval;
+        if (0 < m_resume_phase_ns) {
+            // Continue the gravity phase where the snapshot left off
+            timer_spec.it_value.tv_sec = m_resume_phase_ns / 1000000000L;
+            timer_spec.it_value.tv_nsec = m_resume_phase_ns % 1000000000L;
+        }
+        timerfd_settime(timer_fd, 0, &timer_spec, nullptr);
+
+        // Tracepoints: armed per-probe via TETRIS_TRACE, toggled live with
+        // SIGUSR1 (see tetris_trace.h)
+        TraceRing::instance().init(getenv("TETRIS_TRACE"));
+        signal(SIGUSR1, [](int) { TraceRing::instance().toggle(); });
+
+        bool is_running = true;
+        while (is_running) {
+            m_profiler.beginFrame();
+
+            // Sleep until input or a gravity tick
+            struct pollfd fds[2];
+            fds[0].fd = STDIN_FILENO;
+            fds[0].events = POLLIN;
+            fds[1].fd = timer_fd;
+            fds[1].events = POLLIN;
+            if (poll(fds, 2, -1) <= 0) {
+                continue;
+            }
+            m_profiler.markPhase(FrameProfiler::WAIT);
+
+            // Gravity ticks (one step per expiration)
+            if (fds[1].revents & POLLIN) {
+                uint64_t n_expired = 0;
+                if (read(timer_fd, &n_expired, sizeof(n_expired)) ==
+                    sizeof(n_expired)) {
+                    // More than one expiration means the loop was late: the
+                    // extra ticks are deadline misses (still simulated, so
+                    // game time never drifts behind wall time)
+                    if (1 < n_expired) {
+                        m_profiler.noteMissedTicks(
+                            static_cast<uint32_t>(n_expired - 1));
+                    }
+                    for (uint64_t i = 0; i < n_expired; i++) {
+                        stepEngine(Input::TICK);
+                    }
+                    if (!m_snapshot_path.empty()) {
+                        autosnapshot(timer_fd);
+                    }
+                }
+            }
 
-enum class Color : char {
-    BLACK = 0,
-    RED,
-    GREEN,
-    ORANGE,
-    BLUE,
-    PURPLE,
-    LIGHT_BLUE,
-    WHITE
-};
+            // Drain all pending keys
+            if (fds[0].revents & POLLIN) {
+                char key;
+                while (m_nonblock_term->getKey(key)) {
+                    if (key == ' ' || key == 'r') {
+                        stepEngine(Input::ROTATE);
+                    }
+                    if (key == 'h') {
+                        // Left
+                        stepEngine(Input::LEFT);
+                    }
+                    if (key == 'l') {
+                        // Right
+                        stepEngine(Input::RIGHT);
+                    }
+                    if (key == 'j') {
+                        // Down
+                        stepEngine(Input::DOWN);
+                    }
+                    if (key == 'k') {
+                        // Hard drop
+                        stepEngine(Input::DROP);
+                    }
+                    if (key == 'q') {
+                        is_running = false;
+                    }
+                }
+            }
 
-class Block {
-public:
-    Block() {}
-    virtual ~Block() {}
-    virtual std::shared_ptr<Block> clone() const = 0;
-
-    void move(int dx, int dy) { setPos(m_x + dx, m_y + dy); }
-    void setPos(int x, int y) {
-        m_x = x;
-        m_y = y;
-    }
-    void rotate() {
-        m_rot = static_cast<Rot>((static_cast<int>(m_rot) + 1) % 4);
-    }
+            // Check whether game over
+            if (m_engine.isGameOver()) {
+                const char msg[] = "Game Over\n";
+                m_renderer.writeRaw(msg, sizeof(msg) - 1);
+                break;
+            }
+            m_profiler.markPhase(FrameProfiler::LOGIC);
+
+            // Redraw (only the changed cells are repainted)
+            drawFrame();
+            if (m_hud_enabled) {
+                // The renderer parks the cursor under the field; going
+                // through writeRaw keeps the HUD ordered after the frame
+                // it belongs to on the writer thread
+                const std::string hud = m_profiler.makeHudLine();
+                m_renderer.writeRaw(hud.data(), hud.size());
+            }
+            m_profiler.markPhase(FrameProfiler::DRAW);
+            m_profiler.endFrame();
+        }
 
-    virtual void getRange(int* sx, int* sy, int* ex, int* ey) const = 0;
-    virtual bool exist(int x, int y) const = 0;
-    virtual Color getColor() const = 0;
+        close(timer_fd);
 
-protected:
-    enum Rot { ROT0, ROT90, ROT180, ROT270 };
+        // Drain the frame writer before dumping through stdio, so the stats
+        // below never interleave with still-pending frame bytes
+        m_renderer.disableAsyncWrites();
 
-    int m_x, m_y;
-    Rot m_rot = ROT0;
-};
+        // Where did the frame budget go?
+        m_profiler.dumpStats(stdout);
+        TraceRing::instance().dump(stdout);
+    }
 
-struct BlockShape0 {
-    constexpr static int W = 4;
-    constexpr static int H = 4;
-    constexpr static char SHAPE[H][W] = {
-        {0, 0, 0, 0},
-        {1, 1, 1, 1},
-        {0, 0, 0, 0},
-        {0, 0, 0, 0},
-    };
-    constexpr static Color COL = Color::LIGHT_BLUE;
-};
+private:
+    void stepEngine(Input input) {
+        m_engine.step(input);
+        if (m_replay_writer) {
+            const auto elapsed = std::chrono::steady_clock::now() - m_start_time;
+            m_replay_writer->record(
+                input,
+                static_cast<uint32_t>(
+                    std::chrono::duration_cast<std::chrono::milliseconds>(
+                        elapsed)
+                        .count()));
+        }
+    }
 
-struct BlockShape1 {
-    constexpr static int W = 3;
-    constexpr static int H = 3;
-    constexpr static char SHAPE[H][W] = {
-        {1, 0, 0},
-        {1, 1, 1},
-        {0, 0, 0},
-    };
-    constexpr static Color COL = Color::BLUE;
-};
+    void autosnapshot(int timer_fd) {
+        // One buffered write per gravity tick; the saved phase lets resume
+        // rearm the timer exactly where this session stood
+        struct itimerspec rest;
+        uint64_t phase_ns = 0;
+        if (timerfd_gettime(timer_fd, &rest) == 0) {
+            phase_ns = static_cast<uint64_t>(rest.it_value.tv_sec) *
+                           1000000000ULL +
+                       rest.it_value.tv_nsec;
+        }
+        SaveSnapshot(m_engine, phase_ns, m_snapshot_path);
+    }
 
-struct BlockShape2 {
-    constexpr static int W = 3;
-    constexpr static int H = 3;
-    constexpr static char SHAPE[H][W] = {
-        {0, 0, 1},
-        {1, 1, 1},
-        {0, 0, 0},
-    };
-    constexpr static Color COL = Color::ORANGE;
-};
+    void drawFrame() {
+        // The falling block is composited as an overlay; the settled field
+        // is not copied. The ghost preview reuses the hard-drop landing row.
+        const BlockMap& map = m_engine.getBlockMap();
+        const Block& block = m_engine.getBlock();
+        m_renderer.draw(map, &block, m_engine.getNumErasedLines(),
+                        map.dropDistance(block));
+    }
 
-struct BlockShape3 {
-    constexpr static int W = 2;
-    constexpr static int H = 2;
-    constexpr static char SHAPE[H][W] = {
-        {1, 1},
-        {1, 1},
-    };
-    constexpr static Color COL = Color::WHITE;
+    std::unique_ptr<NonblockTerm> m_nonblock_term;
+    TetrisEngine m_engine;
+    ScreenRenderer m_renderer;
+    FrameProfiler m_profiler;
+    std::unique_ptr<ReplayWriter> m_replay_writer;
+    std::chrono::steady_clock::time_point m_start_time;
+    const std::string m_snapshot_path;
+    uint64_t m_resume_phase_ns = 0;
+    const bool m_hud_enabled = (getenv("TETRIS_HUD") != nullptr);
+    const long EVENT_INTERVAL_NS;
 };
 
-struct BlockShape4 {
-    constexpr static int W = 3;
-    constexpr static int H = 3;
-    constexpr static char SHAPE[H][W] = {
-        {0, 1, 1},
-        {1, 1, 0},
-        {0, 0, 0},
-    };
-    constexpr static Color COL = Color::GREEN;
-};
+// Lockstep netplay session (see tetris_lockstep.h): both ends simulate
+// both engines and exchange one 6-byte input packet per tick, so remote
+// play costs bytes per tick instead of kilobytes of frame diff - and the
+// opponent's attacks land with local-simulation latency. The local field
+// is rendered as usual; the peer's engine runs headless behind a status
+// line. Garbage exchange reuses the versus rules and needs no packets:
+// both ends compute the same attacks from the same state.
+class LockstepApp {
+public:
+    LockstepApp(int sock_fd, const LockstepHello& hello, bool is_host)
+        : m_sock_fd(sock_fd),
+          m_is_host(is_host),
+          m_local_engine(hello.w, hello.h,
+                         is_host ? hello.seed : hello.seed + 1),
+          m_remote_engine(hello.w, hello.h,
+                          is_host ? hello.seed + 1 : hello.seed),
+          m_pipeline(hello.delay),
+          m_renderer(hello.w, hello.h) {
+        m_renderer.enableAsyncWrites();
+    }
 
-struct BlockShape5 {
-    constexpr static int W = 3;
-    constexpr static int H = 3;
-    constexpr static char SHAPE[H][W] = {
-        {0, 1, 0},
-        {1, 1, 1},
-        {0, 0, 0},
-    };
-    constexpr static Color COL = Color::PURPLE;
-};
+    int run() {
+        drawFrame();
+
+        // Simulation ticks from a timerfd, as in the solo app; every tick
+        // is also one input-packet exchange
+        const int timer_fd = timerfd_create(CLOCK_MONOTONIC, 0);
+        struct itimerspec timer_spec = {};
+        timer_spec.it_interval.tv_nsec = 1000000000L / TICK_HZ;
+        timer_spec.it_value = timer_spec.it_interval;
+        timerfd_settime(timer_fd, 0, &timer_spec, nullptr);
+
+        bool is_running = true;
+        while (is_running) {
+            struct pollfd fds[3];
+            fds[0].fd = STDIN_FILENO;
+            fds[0].events = POLLIN;
+            fds[1].fd = timer_fd;
+            fds[1].events = POLLIN;
+            fds[2].fd = m_sock_fd;
+            fds[2].events = POLLIN;
+            if (poll(fds, 3, -1) <= 0) {
+                continue;
+            }
 
-struct BlockShape6 {
-    constexpr static int W = 3;
-    constexpr static int H = 3;
-    constexpr static char SHAPE[H][W] = {
-        {1, 1, 0},
-        {0, 1, 1},
-        {0, 0, 0},
-    };
-    constexpr static Color COL = Color::RED;
-};
+            if (fds[2].revents & POLLIN) {
+                if (!pumpSocket()) {
+                    break;  // pumpSocket reported the reason
+                }
+            }
 
-template <typename T>
-class BlockImpl : public Block {
-public:
-    using Shape = T;
+            if (fds[1].revents & POLLIN) {
+                uint64_t n_expired = 0;
+                if (read(timer_fd, &n_expired, sizeof(n_expired)) ==
+                    sizeof(n_expired)) {
+                    for (uint64_t i = 0; i < n_expired && is_running; i++) {
+                        is_running = advanceTick();
+                    }
+                }
+            }
 
-    BlockImpl() {}
-    virtual ~BlockImpl() {}
-    virtual std::shared_ptr<Block> clone() const {
-        return std::make_shared<BlockImpl<T> >(*this);
-    }
+            if (fds[0].revents & POLLIN) {
+                is_running = is_running && drainKeys();
+            }
 
-    virtual void getRange(int* sx, int* sy, int* ex, int* ey) const {
-        constexpr int sx0 = -W_L;
-        constexpr int sy0 = -H_L;
-        constexpr int ex0 = W_R - 1;
-        constexpr int ey0 = H_R - 1;
-        if (m_rot == ROT0 || m_rot == ROT180) {
-            (*sx) = m_x + sx0;
-            (*sy) = m_y + sy0;
-            (*ex) = m_x + ex0;
-            (*ey) = m_y + ey0;
-        } else {
-            (*sx) = m_x + sy0;
-            (*sy) = m_y + sx0;
-            (*ex) = m_x + ey0;
-            (*ey) = m_y + ex0;
+            drawFrame();
         }
+        close(timer_fd);
+        return m_failed ? 1 : 0;
     }
 
-    virtual bool exist(int x, int y) const {
-        const int x0_idx = x - (m_x - W_L);
-        const int y0_idx = y - (m_y - H_L);
-        if (m_rot == ROT0) {
-            return Shape::SHAPE[y0_idx][x0_idx];
-        } else if (m_rot == ROT90) {
-            return Shape::SHAPE[x0_idx][Shape::H - y0_idx - 1];
-        } else if (m_rot == ROT180) {
-            return Shape::SHAPE[Shape::H - y0_idx - 1][Shape::W - x0_idx - 1];
-        } else if (m_rot == ROT270) {
-            return Shape::SHAPE[Shape::W - x0_idx - 1][y0_idx];
+private:
+    constexpr static long TICK_HZ = 30;
+    constexpr static uint32_t TICKS_PER_DROP = 30;  // 1 gravity step per s
+
+    static Input KeyToInput(char key) {
+        switch (key) {
+            case ' ':
+            case 'r': return Input::ROTATE;
+            case 'h': return Input::LEFT;
+            case 'l': return Input::RIGHT;
+            case 'j': return Input::DOWN;
+            case 'k': return Input::DROP;
+            default: return Input::NONE;
         }
-        assert(false);
-        return false;
     }
 
-    virtual Color getColor() const { return Shape::COL; }
-
-protected:
-    constexpr static int W_L = Shape::W / 2;
-    constexpr static int W_R = Shape::W - W_L;
-    constexpr static int H_L = Shape::H / 2;
-    constexpr static int H_R = Shape::H - H_L;
-};
-
-class RandomBlockGenerator {
-public:
-    RandomBlockGenerator(int x, int y) : m_x(x), m_y(y), m_mt(m_rnd()) {}
-    std::shared_ptr<Block> operator()() {
-        const int idx = m_mt() % 7;
-        std::shared_ptr<Block> block;
-        if (idx == 0) {
-            block = std::make_shared<BlockImpl<BlockShape0> >();
-        } else if (idx == 1) {
-            block = std::make_shared<BlockImpl<BlockShape1> >();
-        } else if (idx == 2) {
-            block = std::make_shared<BlockImpl<BlockShape2> >();
-        } else if (idx == 3) {
-            block = std::make_shared<BlockImpl<BlockShape3> >();
-        } else if (idx == 4) {
-            block = std::make_shared<BlockImpl<BlockShape4> >();
-        } else if (idx == 5) {
-            block = std::make_shared<BlockImpl<BlockShape5> >();
-        } else if (idx == 6) {
-            block = std::make_shared<BlockImpl<BlockShape6> >();
-        } else {
-            assert(false);
+    // Collect pending keys; false when 'q' asked to quit
+    bool drainKeys() {
+        char key;
+        while (m_nonblock_term.getKey(key)) {
+            if (key == 'q') {
+                return false;
+            }
+            if (m_pending_input == Input::NONE) {
+                m_pending_input = KeyToInput(key);
+            }
         }
-        // Set default position
-        block->setPos(m_x, m_y);
-        return block;
+        return true;
     }
 
-private:
-    int m_x, m_y;
-    std::random_device m_rnd;
-    std::mt19937 m_mt;
-};
-
-void ClearScreen() {
-    std::cout << "\e[2J";    // Clear all
-    std::cout << "\e[0;0H";  // Go to top left
-}
-
-void PrintColorCode(Color col) {
-    std::cout << "\e[4" << static_cast<int>(col) << "m";
-}
+    // Execute one lockstep tick; both ends run this same function with the
+    // same inputs, so every statement here must be deterministic
+    bool advanceTick() {
+        const uint32_t t = m_tick;
+        // The remote input for this tick is usually long since here (the
+        // pipeline gave it `delay` ticks of head start). When it is not -
+        // the peer runs behind or the link hiccuped - stall until it
+        // arrives, but keep serving the keyboard so quitting still works
+        while (!m_pipeline.remoteReady(t)) {
+            struct pollfd fds[2];
+            fds[0].fd = m_sock_fd;
+            fds[0].events = POLLIN;
+            fds[1].fd = STDIN_FILENO;
+            fds[1].events = POLLIN;
+            if (poll(fds, 2, -1) <= 0) {
+                continue;
+            }
+            if ((fds[1].revents & POLLIN) && !drainKeys()) {
+                return false;
+            }
+            if ((fds[0].revents & POLLIN) && !pumpSocket()) {
+                return false;  // pumpSocket reported the reason
+            }
+        }
 
-void ResetColorCode() { std::cout << "\e[0m"; }
+        // Sample and ship the local input for tick t + delay
+        const LockstepInput out = m_pipeline.scheduleLocal(t, m_pending_input);
+        m_pending_input = Input::NONE;
+        if (!sendAll(&out, sizeof(out))) {
+            notePeerGone();
+            return false;
+        }
 
-class BlockMap {
-public:
-    BlockMap() {}
-    BlockMap(size_t w, size_t h)
-        : m_w(w), m_h(h), m_blocks(w * h, Color::BLACK) {}
-
-    bool exist(int x, int y) const { return static_cast<bool>(get(x, y)); }
-
-    bool isPuttable(const Block& block) const {
-        // Existing range
-        int sx, sy, ex, ey;
-        block.getRange(&sx, &sy, &ex, &ey);
-
-        // Check field range and block's overlapping
-        for (int y = sy; y <= ey; y++) {
-            for (int x = sx; x <= ex; x++) {
-                if (!block.exist(x, y)) {
-                    continue;
-                }
-                // Ignore -Y
-                if (y < 0) {
-                    continue;
-                }
-                // Check
-                if (x < 0 || m_w <= x || m_h <= y || this->exist(x, y)) {
-                    return false;
-                }
+        // Host engine first on both ends, so the shared order is fixed
+        TetrisEngine& host_eng = m_is_host ? m_local_engine : m_remote_engine;
+        TetrisEngine& join_eng = m_is_host ? m_remote_engine : m_local_engine;
+        const Input host_in =
+            m_is_host ? m_pipeline.localAt(t) : m_pipeline.remoteAt(t);
+        const Input join_in =
+            m_is_host ? m_pipeline.remoteAt(t) : m_pipeline.localAt(t);
+        if (host_in != Input::NONE) {
+            host_eng.step(host_in);
+        }
+        if (join_in != Input::NONE) {
+            join_eng.step(join_in);
+        }
+        if ((t + 1) % TICKS_PER_DROP == 0) {
+            host_eng.step(Input::TICK);
+            join_eng.step(Input::TICK);
+        }
+        // Versus garbage, computed locally on both ends from the same state
+        applyPendingAttack(host_eng, join_eng, &m_host_lines_counted);
+        applyPendingAttack(join_eng, host_eng, &m_join_lines_counted);
+        m_tick++;
+
+        if ((t + 1) % LOCKSTEP_HASH_INTERVAL == 0) {
+            if (!exchangeHashes(t)) {
+                return false;
             }
         }
+
+        if (m_local_engine.isGameOver() || m_remote_engine.isGameOver()) {
+            // Both ends reach this verdict from their own simulation
+            statusLine(m_local_engine.isGameOver() ? "Game over - you lose"
+                                                   : "Peer topped out - you win");
+            return false;
+        }
         return true;
     }
 
-    void putBlock(const Block& block) {
-        // Existing range
-        int sx, sy, ex, ey;
-        block.getRange(&sx, &sy, &ex, &ey);
-        sx = std::max(0, sx);
-        sy = std::max(0, sy);
-        ex = std::min(static_cast<int>(m_w), ex);
-        ey = std::min(static_cast<int>(m_h), ey);
-
-        // Put
-        const Color col = block.getColor();
-        for (size_t y = sy; y <= ey; y++) {
-            for (size_t x = sx; x <= ex; x++) {
-                if (block.exist(x, y)) {
-                    get(x, y) = col;
-                }
+    static void applyPendingAttack(TetrisEngine& from, TetrisEngine& to,
+                                   int* watermark) {
+        const int n_erased = from.getNumErasedLines();
+        const int delta = n_erased - *watermark;
+        *watermark = n_erased;
+        if (delta < 2) {
+            return;
+        }
+        const int n_rows = AttackRows(delta);
+        if (0 < n_rows) {
+            const int hole_x =
+                static_cast<int>(from.getSeed() + n_erased) %
+                static_cast<int>(to.getBlockMap().width());
+            ApplyVersusMsg(to, MakeAttackMsg(n_rows, hole_x));
+        }
+    }
+
+    // Send our engine's digest for tick t and match the peer's, whichever
+    // side got here first
+    bool exchangeHashes(uint32_t t) {
+        LockstepHash msg{};
+        msg.type = LOCKSTEP_HASH;
+        msg.tick = t;
+        msg.hash = m_local_engine.stateHash();
+        if (!sendAll(&msg, sizeof(msg))) {
+            notePeerGone();
+            return false;
+        }
+        // Compare the peer's digest (if it already arrived) against our
+        // simulation of its engine
+        uint64_t peer_hash = 0;
+        if (m_received_hashes.take(t, &peer_hash)) {
+            if (peer_hash != m_remote_engine.stateHash()) {
+                statusLine("Desync detected - aborting");
+                m_failed = true;
+                return false;
             }
+            return true;
         }
+        m_simulated_hashes.push(t, m_remote_engine.stateHash());
+        return true;
     }
 
-    int eraseFilledLines() {
-        int n_erased_lines = 0;
-        for (int y = m_h - 1; 0 <= y; y--) {
-            // Check is the line filled
-            bool is_filled = true;
-            for (size_t x = 0; x < m_w; x++) {
-                if (get(x, y) == Color::BLACK) {
-                    is_filled = false;
-                    break;
-                }
+    // Drain the socket and dispatch complete messages; false when the peer
+    // hung up or the stream is corrupt
+    bool pumpSocket() {
+        char buf[512];
+        while (true) {
+            const ssize_t n = recv(m_sock_fd, buf, sizeof(buf), MSG_DONTWAIT);
+            if (n == 0) {
+                notePeerGone();
+                return false;
             }
-            // Erase the line
-            if (is_filled) {
-                n_erased_lines++;
-                // Shift
-                for (size_t yy = y; 1 <= yy; yy--) {
-                    for (size_t x = 0; x < m_w; x++) {
-                        get(x, yy) = get(x, yy - 1);
+            if (n < 0) {
+                break;  // Drained (EAGAIN)
+            }
+            m_decoder.feed(buf, static_cast<size_t>(n));
+        }
+        char msg[sizeof(LockstepHash)];
+        int type;
+        while (0 < (type = m_decoder.next(msg))) {
+            if (type == LOCKSTEP_INPUT) {
+                LockstepInput in;
+                std::memcpy(&in, msg, sizeof(in));
+                m_pipeline.pushRemote(in);
+            } else if (type == LOCKSTEP_HASH) {
+                LockstepHash hash_msg;
+                std::memcpy(&hash_msg, msg, sizeof(hash_msg));
+                uint64_t mine = 0;
+                if (m_simulated_hashes.take(hash_msg.tick, &mine)) {
+                    if (mine != hash_msg.hash) {
+                        statusLine("Desync detected - aborting");
+                        m_failed = true;
+                        return false;
                     }
+                } else {
+                    m_received_hashes.push(hash_msg.tick, hash_msg.hash);
                 }
-                // Last line
-                for (size_t x = 0; x < m_w; x++) {
-                    get(x, 0) = Color::BLACK;
-                }
-                // Check current line again
-                y++;
             }
         }
-        return n_erased_lines;
+        if (type < 0) {
+            statusLine("Bad packet from peer - aborting");
+            m_failed = true;
+            return false;
+        }
+        return true;
     }
 
-    void draw() {
-        // Top wall
-        printWall(m_w + 2);
-        newline();
-
-        // Print all blocks
-        size_t idx = 0;
-        for (size_t y = 0; y < m_h; y++) {
-            // Left wall
-            printWall(1);
-            for (size_t x = 0; x < m_w; x++, idx++) {
-                // Write one block
-                PrintColorCode(m_blocks[idx]);
-                std::cout << "　";
+    bool sendAll(const void* data, size_t n) {
+        const char* p = static_cast<const char*>(data);
+        while (0 < n) {
+            const ssize_t sent = send(m_sock_fd, p, n, MSG_NOSIGNAL);
+            if (sent <= 0) {
+                return false;
             }
-            // Right wall
-            printWall(1);
-            newline();
+            p += sent;
+            n -= static_cast<size_t>(sent);
         }
-
-        // Button wall
-        printWall(m_w + 2);
-        newline();
-    }
-
-private:
-    const Color& get(int x, int y) const { return m_blocks[y * m_w + x]; }
-
-    Color& get(int x, int y) {
-        return const_cast<Color&>(
-            (static_cast<const BlockMap*>(this)->get(x, y)));
+        return true;
     }
 
-    void printWall(size_t n) {
-        // Print white wall
-        PrintColorCode(Color::WHITE);
-        for (size_t x = 0; x < n; x++) {
-            std::cout << "　";
-        }
+    void notePeerGone() { statusLine("Peer disconnected"); }
+
+    void drawFrame() {
+        const BlockMap& map = m_local_engine.getBlockMap();
+        const Block& block = m_local_engine.getBlock();
+        m_renderer.draw(map, &block, m_local_engine.getNumErasedLines(),
+                        map.dropDistance(block));
+        // Peer summary where the solo app parks its HUD
+        char line[64];
+        const int n = std::snprintf(
+            line, sizeof(line), "Peer: %d lines, stack %d   ",
+            m_remote_engine.getNumErasedLines(),
+            m_remote_engine.getBlockMap().getMaxHeight());
+        m_renderer.writeRaw(line, static_cast<size_t>(n));
     }
 
-    void newline() {
-        // Reset color for the rest of line
-        ResetColorCode();
-        std::cout << std::endl;
+    void statusLine(const char* text) {
+        char line[96];
+        const int n = std::snprintf(line, sizeof(line), "\r\e[0m%s\e[K\n",
+                                    text);
+        m_renderer.writeRaw(line, static_cast<size_t>(n));
     }
 
-    size_t m_w, m_h;
-    std::vector<Color> m_blocks;
+    NonblockTerm m_nonblock_term;
+    int m_sock_fd;
+    bool m_is_host;
+    TetrisEngine m_local_engine;
+    TetrisEngine m_remote_engine;  // Simulated copy of the peer
+    InputPipeline m_pipeline;
+    ScreenRenderer m_renderer;
+    LockstepDecoder m_decoder;
+    LockstepHashLog m_simulated_hashes;  // Our digests of the peer engine
+    LockstepHashLog m_received_hashes;   // Digests the peer sent early
+    Input m_pending_input = Input::NONE;
+    uint32_t m_tick = 0;
+    int m_host_lines_counted = 0;
+    int m_join_lines_counted = 0;
+    bool m_failed = false;
 };
 
-template <typename Action, typename... Args>
-bool TryBlockAction(Block& block, const BlockMap& block_map, Action action,
-                    Args&&... args) {
-    // Create clone and try to act
-    std::shared_ptr<Block> block_tmp = block.clone();
-    ((*block_tmp).*action)(std::forward<Args>(args)...);
-    // Check
-    if (block_map.isPuttable(*block_tmp)) {
-        // Overwrite the original one
-        block = *block_tmp;
-        return true;
+// The host listens on a unix socket and owns the session parameters; the
+// joiner connects and adopts them from the HELLO
+int RunNetplay(const std::string& path, bool host, int delay, size_t w,
+               size_t h) {
+    int sock_fd = -1;
+    LockstepHello hello = {};
+    if (host) {
+        const int listen_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        unlink(path.c_str());
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (listen_fd < 0 ||
+            bind(listen_fd, reinterpret_cast<struct sockaddr*>(&addr),
+                 sizeof(addr)) < 0 ||
+            listen(listen_fd, 1) < 0) {
+            std::cerr << "Cannot listen on " << path << std::endl;
+            return 1;
+        }
+        std::cout << "Waiting for a peer on " << path << "..." << std::endl;
+        sock_fd = accept(listen_fd, nullptr, nullptr);
+        close(listen_fd);
+        hello.type = LOCKSTEP_HELLO;
+        hello.delay = static_cast<uint8_t>(delay);
+        hello.w = static_cast<uint16_t>(w);
+        hello.h = static_cast<uint16_t>(h);
+        hello.seed = static_cast<uint32_t>(
+            std::chrono::steady_clock::now().time_since_epoch().count());
+        if (sock_fd < 0 ||
+            write(sock_fd, &hello, sizeof(hello)) != sizeof(hello)) {
+            std::cerr << "Peer handshake failed" << std::endl;
+            return 1;
+        }
     } else {
-        return false;
+        sock_fd = socket(AF_UNIX, SOCK_STREAM, 0);
+        struct sockaddr_un addr = {};
+        addr.sun_family = AF_UNIX;
+        std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+        if (sock_fd < 0 ||
+            connect(sock_fd, reinterpret_cast<struct sockaddr*>(&addr),
+                    sizeof(addr)) < 0 ||
+            read(sock_fd, &hello, sizeof(hello)) != sizeof(hello) ||
+            hello.type != LOCKSTEP_HELLO) {
+            std::cerr << "Cannot join " << path << std::endl;
+            return 1;
+        }
     }
+    LockstepApp app(sock_fd, hello, host);
+    const int ret = app.run();
+    close(sock_fd);
+    return ret;
 }
 
-class TetrisApp {
-public:
-    TetrisApp(size_t w, size_t h, double fps = 15.f, double event_fps = 1.f)
-        : m_block_map(w, h),
-          m_rand_block_gen(w / 2, 0),
-          m_fps_stabler(fps),
-          m_event_clock(event_fps) {}
-
-    void run() {
-        int n_erased_lines = 0;
-        bool is_next_block = false;
-        std::shared_ptr<Block> block = m_rand_block_gen();
-        while (true) {
-
-            // Generate new block
-            if (is_next_block) {
-                is_next_block = false;
-                block = m_rand_block_gen();
-                // Check whether game over
-                if (!m_block_map.isPuttable(*block)) {
-                    std::cout << "Game Over" << std::endl;
-                    break;
-                }
-            }
+// Re-simulate a recorded session through the headless engine at maximum
+// speed (hours of play replay in seconds); rendering is optional.
+int PlaybackReplay(const std::string& path, bool render) {
+    ReplayReader reader(path);
+    if (!reader.isOpen()) {
+        std::cerr << "Cannot open replay: " << path << std::endl;
+        return 1;
+    }
+    const ReplayHeader& header = reader.getHeader();
+    TetrisEngine engine(header.w, header.h, header.seed);
+    std::unique_ptr<ScreenRenderer> renderer;
+    if (render) {
+        renderer = std::make_unique<ScreenRenderer>(header.w, header.h);
+    }
 
-            // Backup current map
-            const auto block_map_org = m_block_map;
-            // Put a current block
-            m_block_map.putBlock(*block);
-
-            // Events
-            if (m_event_clock.shouldHappen()) {
-                // Go down
-                is_next_block =
-                    !TryBlockAction(*block, block_map_org, &Block::move, 0, 1);
-                // Erase filled lines
-                n_erased_lines += m_block_map.eraseFilledLines();
-            }
+    size_t n_events = 0;
+    ReplayEvent event;
+    while (reader.next(&event)) {
+        engine.step(static_cast<Input>(event.input));
+        n_events++;
+        if (renderer) {
+            renderer->draw(engine.getBlockMap(), &engine.getBlock(),
+                           engine.getNumErasedLines());
+        }
+    }
+    std::cout << "Replayed " << n_events << " inputs, point "
+              << engine.getNumErasedLines()
+              << (engine.isGameOver() ? " (game over)" : "") << std::endl;
+    return 0;
+}
 
-            // Draw screen
-            ClearScreen();
-            std::cout << "Point: " << n_erased_lines << std::endl;
-            m_block_map.draw();
-            if (!is_next_block) {
-                // Remove the current block
-                m_block_map = block_map_org;
+int main(int argc, char** argv) {
+    // Frames go out through raw write(2); unhook the C-stream sync so the
+    // handful of std::cout messages cost no stdio coupling at startup
+    std::ios::sync_with_stdio(false);
+
+    // Usage: tetris [--record FILE] [--replay FILE [--render]]
+    std::string record_path, replay_path, snapshot_path, netplay_path;
+    size_t field_w = 11, field_h = 20;
+    int netplay_delay = 3;
+    bool render = false;
+    bool netplay_host = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--record" && i + 1 < argc) {
+            record_path = argv[++i];
+        } else if (arg == "--replay" && i + 1 < argc) {
+            replay_path = argv[++i];
+        } else if (arg == "--render") {
+            render = true;
+        } else if (arg == "--snapshot" && i + 1 < argc) {
+            snapshot_path = argv[++i];
+        } else if (arg == "--netplay" && i + 1 < argc) {
+            netplay_path = argv[++i];
+        } else if (arg == "--listen") {
+            netplay_host = true;
+        } else if (arg == "--delay" && i + 1 < argc) {
+            // Input-delay pipeline depth in lockstep ticks; the
+            // wait-before-send tick ordering needs at least one tick of
+            // slack, and 255 is the wire format's ceiling
+            netplay_delay = std::atoi(argv[++i]);
+            if (netplay_delay < 1 || 255 < netplay_delay) {
+                std::cerr << "Bad --delay (expected 1..255): " << argv[i]
+                          << std::endl;
+                return 1;
             }
-
-            // Check key input
-            char key;
-            if (m_nonblock_term.getKey(key)) {
-                if (key == ' ' || key == 'r') {
-                    TryBlockAction(*block, m_block_map, &Block::rotate);
-                }
-                if (key == 'h') {
-                    // Left
-                    TryBlockAction(*block, m_block_map, &Block::move, -1, 0);
-                }
-                if (key == 'l') {
-                    // Right
-                    TryBlockAction(*block, m_block_map, &Block::move, 1, 0);
-                }
-                if (key == 'j') {
-                    // Down
-                    TryBlockAction(*block, m_block_map, &Block::move, 0, 1);
-                }
-                if (key == 'q') {
-                    break;
-                }
+        } else if (arg == "--field" && i + 1 < argc) {
+            // Large-field mode: e.g. --field 200x400
+            if (std::sscanf(argv[++i], "%zux%zu", &field_w, &field_h) != 2 ||
+                field_w == 0 || field_h == 0) {
+                std::cerr << "Bad field size: " << argv[i] << std::endl;
+                return 1;
             }
-
-            // Sleep
-            m_fps_stabler.sleep();
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--record FILE] [--replay FILE [--render]]"
+                         " [--snapshot FILE] [--field WxH]"
+                         " [--netplay SOCK [--listen] [--delay N]]"
+                      << std::endl;
+            return 1;
         }
     }
 
-private:
-    NonblockTerm m_nonblock_term;
-    BlockMap m_block_map;
-    RandomBlockGenerator m_rand_block_gen;
-    FpsStabler m_fps_stabler;
-    EventClock m_event_clock;
-};
+    if (!replay_path.empty()) {
+        return PlaybackReplay(replay_path, render);
+    }
+    if (!netplay_path.empty()) {
+        return RunNetplay(netplay_path, netplay_host, netplay_delay, field_w,
+                          field_h);
+    }
 
-int main() {
-    TetrisApp app(11, 20);
+    TetrisApp app(field_w, field_h, 1.0, record_path, snapshot_path);
     app.run();
 
     return 0;
@@ -0,0 +1,243 @@
+// Microbenchmark suite for the hot paths: isPuttable, putBlock,
+// eraseFilledLines, TryBlockAction, engine steps and full-frame rendering.
+// Self-contained runner (no external benchmark dependency): each case is
+// timed over auto-calibrated iterations and reported as ns/op together with
+// heap allocation counts from an operator-new hook.
+//
+// Build: make bench
+
+#include <fcntl.h>
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <new>
+
+#include "tetris_engine.h"
+#include "tetris_render.h"
+#include "tetris_search.h"
+#include "tetris_simd.h"
+
+// ---------------------------- Allocation hook ------------------------------
+static size_t g_n_allocs = 0;
+static size_t g_alloc_bytes = 0;
+
+void* operator new(size_t size) {
+    g_n_allocs++;
+    g_alloc_bytes += size;
+    void* ptr = std::malloc(size);
+    if (!ptr) {
+        throw std::bad_alloc();
+    }
+    return ptr;
+}
+
+void operator delete(void* ptr) noexcept { std::free(ptr); }
+void operator delete(void* ptr, size_t) noexcept { std::free(ptr); }
+
+// ---------------------------- Benchmark runner -----------------------------
+template <typename Body>
+void RunBench(const char* name, Body&& body) {
+    using Clock = std::chrono::steady_clock;
+
+    // Warm up and calibrate the iteration count to ~100ms
+    size_t n_iters = 1;
+    while (true) {
+        const auto s = Clock::now();
+        for (size_t i = 0; i < n_iters; i++) {
+            body();
+        }
+        const double elapsed_ns =
+            std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                                 s)
+                .count();
+        if (1e8 <= elapsed_ns || 100000000 <= n_iters) {
+            break;
+        }
+        n_iters *= 10;
+    }
+
+    // Measure
+    const size_t allocs_org = g_n_allocs;
+    const size_t bytes_org = g_alloc_bytes;
+    const auto start = Clock::now();
+    for (size_t i = 0; i < n_iters; i++) {
+        body();
+    }
+    const double elapsed_ns =
+        std::chrono::duration_cast<std::chrono::nanoseconds>(Clock::now() -
+                                                             start)
+            .count();
+    const double allocs = static_cast<double>(g_n_allocs - allocs_org);
+    const double bytes = static_cast<double>(g_alloc_bytes - bytes_org);
+
+    std::printf("%-28s %12.1f ns/op %10.2f allocs/op %10.1f bytes/op\n", name,
+                elapsed_ns / n_iters, allocs / n_iters, bytes / n_iters);
+}
+
+// ---------------------------- Field fixtures -------------------------------
+constexpr size_t FIELD_W = 11;
+constexpr size_t FIELD_H = 20;
+
+// Almost-full board: every row but the top two is filled except one column,
+// which is the worst case for line scanning without triggering clears.
+BlockMap MakeNearFullMap() {
+    BlockMap map(FIELD_W, FIELD_H);
+    for (size_t y = 2; y < FIELD_H; y++) {
+        for (size_t x = 0; x < FIELD_W; x++) {
+            if (x != (y % FIELD_W)) {
+                map.setCell(x, y, Color::RED);
+            }
+        }
+    }
+    return map;
+}
+
+// Deep-well board: tall filled columns with a one-column well, which makes
+// collision checks walk long drop paths.
+BlockMap MakeDeepWellMap() {
+    BlockMap map(FIELD_W, FIELD_H);
+    for (size_t y = 4; y < FIELD_H; y++) {
+        for (size_t x = 0; x < FIELD_W - 1; x++) {
+            map.setCell(x, y, Color::BLUE);
+        }
+    }
+    return map;
+}
+
+// Board whose bottom four rows are filled, so eraseFilledLines clears a
+// "tetris" every call after refill.
+void FillBottomRows(BlockMap& map, size_t n_rows) {
+    for (size_t y = FIELD_H - n_rows; y < FIELD_H; y++) {
+        for (size_t x = 0; x < FIELD_W; x++) {
+            map.setCell(x, y, Color::GREEN);
+        }
+    }
+}
+
+// ---------------------------- Benchmarks -----------------------------------
+int main() {
+    // isPuttable against a deep well, probing the whole drop path
+    {
+        const BlockMap map = MakeDeepWellMap();
+        Block block(BlockShape0::ID);
+        RunBench("isPuttable/deep_well", [&]() {
+            // Sink the results: the calls fully inline since the block
+            // became a value type and would otherwise be optimized away
+            int n_puttable = 0;
+            for (int y = 0; y < static_cast<int>(FIELD_H); y++) {
+                block.setPos(FIELD_W - 1, y);
+                n_puttable += map.isPuttable(block) ? 1 : 0;
+            }
+            volatile int sink = n_puttable;
+            (void)sink;
+        });
+    }
+
+    // putBlock into a nearly full board
+    {
+        BlockMap map = MakeNearFullMap();
+        Block block(BlockShape3::ID);
+        block.setPos(FIELD_W / 2, 0);
+        RunBench("putBlock/near_full", [&]() { map.putBlock(block); });
+    }
+
+    // eraseFilledLines clearing four rows (refilled each op)
+    {
+        BlockMap map(FIELD_W, FIELD_H);
+        RunBench("eraseFilledLines/tetris", [&]() {
+            FillBottomRows(map, 4);
+            (void)map.eraseFilledLines();
+        });
+    }
+
+    // eraseFilledLines scanning a near-full board with nothing to clear
+    {
+        BlockMap map = MakeNearFullMap();
+        RunBench("eraseFilledLines/scan_only",
+                 [&]() { (void)map.eraseFilledLines(); });
+    }
+
+    // TryBlockAction rotate/restore against a deep well
+    {
+        const BlockMap map = MakeDeepWellMap();
+        Block block(BlockShape0::ID);
+        block.setPos(FIELD_W / 2, 2);
+        RunBench("TryBlockAction/rotate", [&]() {
+            (void)TryBlockAction(block, map, &Block::rotate);
+        });
+    }
+
+    // Raw engine stepping (gravity ticks, includes spawn and line clears)
+    {
+        auto engine = std::make_unique<TetrisEngine>(FIELD_W, FIELD_H);
+        RunBench("TetrisEngine/step_tick", [&]() {
+            if (!engine->step(Input::TICK)) {
+                // Game over: start a fresh game (rare, amortized away)
+                engine = std::make_unique<TetrisEngine>(FIELD_W, FIELD_H);
+            }
+        });
+    }
+
+    // Line clears on the 200x400 large-field mode
+    {
+        BlockMap map(200, 400);
+        RunBench("eraseFilledLines/200x400", [&]() {
+            for (size_t x = 0; x < 200; x++) {
+                map.setCell(x, 399, Color::GREEN);
+            }
+            (void)map.eraseFilledLines();
+        });
+    }
+
+    // SIMD vs scalar any-zero scan over a 200-cell wide row
+    {
+        std::vector<Color> wide_row(200, Color::RED);
+        size_t iter = 0;
+        RunBench("RowHasEmptyCell/200col", [&]() {
+            // Move the hole so the scan cannot be hoisted out of the loop
+            wide_row[173] = (iter++ & 1) ? Color::BLACK : Color::RED;
+            volatile bool found = RowHasEmptyCell(wide_row.data(),
+                                                  wide_row.size());
+            (void)found;
+        });
+        RunBench("ScalarRowScan/200col", [&]() {
+            wide_row[173] = (iter++ & 1) ? Color::BLACK : Color::RED;
+            volatile bool found = false;
+            for (size_t x = 0; x < wide_row.size(); x++) {
+                if (wide_row[x] == Color::BLACK) {
+                    found = true;
+                    break;
+                }
+            }
+            (void)found;
+        });
+    }
+
+    // Parallel placement search over all (rotation, column) candidates
+    {
+        const BlockMap map = MakeDeepWellMap();
+        Block block(BlockShape0::ID);
+        block.setPos(FIELD_W / 2, 0);
+        PlacementSearcher searcher;
+        RunBench("PlacementSearcher/find_best",
+                 [&]() { (void)searcher.findBestPlacement(map, block); });
+    }
+
+    // Full-frame render into a sink fd (every cell repainted)
+    {
+        const int sink_fd = open("/dev/null", O_WRONLY);
+        const BlockMap map = MakeNearFullMap();
+        const BlockMap empty_map(FIELD_W, FIELD_H);
+        ScreenRenderer renderer(FIELD_W, FIELD_H, sink_fd);
+        bool flip = false;
+        RunBench("ScreenRenderer/full_diff", [&]() {
+            // Alternate between two frames so every cell differs
+            renderer.draw(flip ? map : empty_map, 0);
+            flip = !flip;
+        });
+        close(sink_fd);
+    }
+
+    return 0;
+}
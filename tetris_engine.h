@@ -0,0 +1,1059 @@
+#ifndef TETRIS_ENGINE_H
+#define TETRIS_ENGINE_H
+
+// Headless game core: field, blocks and rules with no I/O, no sleeps and no
+// terminal dependency. Frontends (interactive, bot, benchmark) drive it
+// through TetrisEngine::step().
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <random>
+#include <vector>
+
+#include "tetris_trace.h"
+
+// Upper bound on field dimensions accepted from external file headers
+// (replays, snapshots): far above any playable field, small enough that a
+// corrupt header can never request an absurd allocation
+constexpr uint32_t MAX_FIELD_DIM = 4096;
+
+enum class Color : char {
+    BLACK = 0,
+    RED,
+    GREEN,
+    ORANGE,
+    BLUE,
+    PURPLE,
+    LIGHT_BLUE,
+    WHITE
+};
+
+struct BlockShape0 {
+    constexpr static int ID = 0;
+    constexpr static int W = 4;
+    constexpr static int H = 4;
+    constexpr static char SHAPE[H][W] = {
+        {0, 0, 0, 0},
+        {1, 1, 1, 1},
+        {0, 0, 0, 0},
+        {0, 0, 0, 0},
+    };
+    constexpr static Color COL = Color::LIGHT_BLUE;
+};
+
+struct BlockShape1 {
+    constexpr static int ID = 1;
+    constexpr static int W = 3;
+    constexpr static int H = 3;
+    constexpr static char SHAPE[H][W] = {
+        {1, 0, 0},
+        {1, 1, 1},
+        {0, 0, 0},
+    };
+    constexpr static Color COL = Color::BLUE;
+};
+
+struct BlockShape2 {
+    constexpr static int ID = 2;
+    constexpr static int W = 3;
+    constexpr static int H = 3;
+    constexpr static char SHAPE[H][W] = {
+        {0, 0, 1},
+        {1, 1, 1},
+        {0, 0, 0},
+    };
+    constexpr static Color COL = Color::ORANGE;
+};
+
+struct BlockShape3 {
+    constexpr static int ID = 3;
+    constexpr static int W = 2;
+    constexpr static int H = 2;
+    constexpr static char SHAPE[H][W] = {
+        {1, 1},
+        {1, 1},
+    };
+    constexpr static Color COL = Color::WHITE;
+};
+
+struct BlockShape4 {
+    constexpr static int ID = 4;
+    constexpr static int W = 3;
+    constexpr static int H = 3;
+    constexpr static char SHAPE[H][W] = {
+        {0, 1, 1},
+        {1, 1, 0},
+        {0, 0, 0},
+    };
+    constexpr static Color COL = Color::GREEN;
+};
+
+struct BlockShape5 {
+    constexpr static int ID = 5;
+    constexpr static int W = 3;
+    constexpr static int H = 3;
+    constexpr static char SHAPE[H][W] = {
+        {0, 1, 0},
+        {1, 1, 1},
+        {0, 0, 0},
+    };
+    constexpr static Color COL = Color::PURPLE;
+};
+
+struct BlockShape6 {
+    constexpr static int ID = 6;
+    constexpr static int W = 3;
+    constexpr static int H = 3;
+    constexpr static char SHAPE[H][W] = {
+        {1, 1, 0},
+        {0, 1, 1},
+        {0, 0, 0},
+    };
+    constexpr static Color COL = Color::RED;
+};
+
+// Expand a shape into its rotated 4x4 occupancy mask at compile time.
+// Bit (y * 4 + x) is the cell (x, y) of the rotated bounding box. All shapes
+// are square, so the same index mapping as the old per-call lookup applies.
+template <typename Shape>
+constexpr uint16_t MakeRotatedShapeMask(int rot) {
+    uint16_t mask = 0;
+    for (int y = 0; y < Shape::H; y++) {
+        for (int x = 0; x < Shape::W; x++) {
+            bool on = false;
+            if (rot == 0) {
+                on = Shape::SHAPE[y][x];
+            } else if (rot == 1) {
+                on = Shape::SHAPE[x][Shape::H - y - 1];
+            } else if (rot == 2) {
+                on = Shape::SHAPE[Shape::H - y - 1][Shape::W - x - 1];
+            } else {
+                on = Shape::SHAPE[Shape::W - x - 1][y];
+            }
+            if (on) {
+                mask |= static_cast<uint16_t>(uint16_t(1) << (y * 4 + x));
+            }
+        }
+    }
+    return mask;
+}
+
+// Lowest occupied row of every rotated-mask column, the per-column profile
+// the O(width) drop-distance computation walks.
+struct ColumnBottomTable {
+    int8_t v[4][4];  // [rot][x]: local y of the lowest cell, -1 when empty
+};
+
+template <typename Shape>
+constexpr ColumnBottomTable MakeColumnBottomTable() {
+    ColumnBottomTable table{};
+    for (int rot = 0; rot < 4; rot++) {
+        const uint16_t mask = MakeRotatedShapeMask<Shape>(rot);
+        for (int x = 0; x < 4; x++) {
+            table.v[rot][x] = -1;
+            for (int y = 0; y < 4; y++) {
+                if ((mask >> (y * 4 + x)) & 1) {
+                    table.v[rot][x] = static_cast<int8_t>(y);
+                }
+            }
+        }
+    }
+    return table;
+}
+
+// Immutable per-shape tables: rotation masks, column-bottom profiles and
+// metadata. One instance per shape lives in SHAPE_INFOS; pieces reference
+// their entry by pointer, so copying a piece copies 24 bytes of pose and a
+// pointer, never shape data.
+struct ShapeInfo {
+    // Per-rotation collision tables: the row masks plus the legal pose
+    // ranges, so a full placement legality test is three compares and one
+    // AND per occupied row with no bounds branches in the loop.
+    struct RotInfo {
+        uint8_t row_bits[4];  // 4-bit mask of each bounding-box row
+        int8_t cy0, cy1;      // First/last occupied bounding-box row
+        int8_t min_x;         // Left wall:  min_x <= pose.x
+        int8_t max_x_off;     // Right wall: pose.x <= w - max_x_off
+        int8_t max_y_off;     // Floor:      pose.y <= h - max_y_off
+    };
+
+    uint16_t rot_masks[4];
+    RotInfo rots[4];
+    ColumnBottomTable col_bottoms;
+    Color color;
+    int8_t id;
+    int8_t w_l, w_r, h_l, h_r;  // Bounding-box extents around the pivot
+};
+
+template <typename Shape>
+constexpr ShapeInfo MakeShapeInfo() {
+    ShapeInfo info{};
+    info.col_bottoms = MakeColumnBottomTable<Shape>();
+    info.color = Shape::COL;
+    info.id = static_cast<int8_t>(Shape::ID);
+    info.w_l = static_cast<int8_t>(Shape::W / 2);
+    info.w_r = static_cast<int8_t>(Shape::W - Shape::W / 2);
+    info.h_l = static_cast<int8_t>(Shape::H / 2);
+    info.h_r = static_cast<int8_t>(Shape::H - Shape::H / 2);
+    for (int rot = 0; rot < 4; rot++) {
+        const uint16_t mask = MakeRotatedShapeMask<Shape>(rot);
+        info.rot_masks[rot] = mask;
+        ShapeInfo::RotInfo& ri = info.rots[rot];
+        int cx0 = 3, cx1 = 0, cy0 = 3, cy1 = 0;
+        for (int y = 0; y < 4; y++) {
+            ri.row_bits[y] = static_cast<uint8_t>((mask >> (y * 4)) & 0xF);
+            for (int x = 0; x < 4; x++) {
+                if ((mask >> (y * 4 + x)) & 1) {
+                    cx0 = std::min(cx0, x);
+                    cx1 = std::max(cx1, x);
+                    cy0 = std::min(cy0, y);
+                    cy1 = std::max(cy1, y);
+                }
+            }
+        }
+        ri.cy0 = static_cast<int8_t>(cy0);
+        ri.cy1 = static_cast<int8_t>(cy1);
+        ri.min_x = static_cast<int8_t>(info.w_l - cx0);
+        ri.max_x_off = static_cast<int8_t>(cx1 - info.w_l + 1);
+        ri.max_y_off = static_cast<int8_t>(cy1 - info.h_l + 1);
+    }
+    return info;
+}
+
+inline constexpr ShapeInfo SHAPE_INFOS[7] = {
+    MakeShapeInfo<BlockShape0>(), MakeShapeInfo<BlockShape1>(),
+    MakeShapeInfo<BlockShape2>(), MakeShapeInfo<BlockShape3>(),
+    MakeShapeInfo<BlockShape4>(), MakeShapeInfo<BlockShape5>(),
+    MakeShapeInfo<BlockShape6>()};
+
+// A piece is a plain value: pose plus a pointer to its shape tables. Every
+// query below inlines into bit tests against the constexpr masks - no
+// virtual dispatch, no heap; speculative moves are a stack copy.
+class Block {
+public:
+    Block() : m_info(&SHAPE_INFOS[0]) {}
+    explicit Block(int shape_id) : m_info(&SHAPE_INFOS[shape_id]) {}
+
+    enum Rot { ROT0, ROT90, ROT180, ROT270 };
+
+    // Mutable state of a block (shape is fixed per instance). Small enough to
+    // snapshot on the stack for speculative moves.
+    struct Pose {
+        int x, y;
+        Rot rot;
+    };
+
+    Pose getPose() const { return {m_x, m_y, m_rot}; }
+    void setPose(const Pose& pose) {
+        m_x = pose.x;
+        m_y = pose.y;
+        m_rot = pose.rot;
+    }
+
+    void move(int dx, int dy) { setPos(m_x + dx, m_y + dy); }
+    void setPos(int x, int y) {
+        m_x = x;
+        m_y = y;
+    }
+    void rotate() {
+        m_rot = static_cast<Rot>((static_cast<int>(m_rot) + 1) % 4);
+    }
+
+    void getRange(int* sx, int* sy, int* ex, int* ey) const {
+        const int sx0 = -m_info->w_l;
+        const int sy0 = -m_info->h_l;
+        const int ex0 = m_info->w_r - 1;
+        const int ey0 = m_info->h_r - 1;
+        if (m_rot == ROT0 || m_rot == ROT180) {
+            (*sx) = m_x + sx0;
+            (*sy) = m_y + sy0;
+            (*ex) = m_x + ex0;
+            (*ey) = m_y + ey0;
+        } else {
+            (*sx) = m_x + sy0;
+            (*sy) = m_y + sx0;
+            (*ex) = m_x + ey0;
+            (*ey) = m_y + ex0;
+        }
+    }
+
+    bool exist(int x, int y) const {
+        const int x0_idx = x - (m_x - m_info->w_l);
+        const int y0_idx = y - (m_y - m_info->h_l);
+        // Branch-free bit test into the precomputed rotation mask
+        return (m_info->rot_masks[m_rot] >> (y0_idx * 4 + x0_idx)) &
+               uint16_t(1);
+    }
+
+    // Occupied cells of field row `y` as a bitmask (bit i <-> column sx + i,
+    // where sx comes from getRange())
+    uint16_t getRowBits(int y) const {
+        const int y0_idx = y - (m_y - m_info->h_l);
+        return (m_info->rot_masks[m_rot] >> (y0_idx * 4)) & uint16_t(0xF);
+    }
+
+    // Field row of the lowest occupied cell in field column `x`, written to
+    // `*y`. Returns false when the block has no cell in that column.
+    bool getColumnBottom(int x, int* y) const {
+        const int x0_idx = x - (m_x - m_info->w_l);
+        if (x0_idx < 0 || 4 <= x0_idx) {
+            return false;
+        }
+        const int8_t bottom = m_info->col_bottoms.v[m_rot][x0_idx];
+        if (bottom < 0) {
+            return false;
+        }
+        (*y) = m_y - m_info->h_l + bottom;
+        return true;
+    }
+
+    Color getColor() const { return m_info->color; }
+    int getShapeId() const { return m_info->id; }
+    const ShapeInfo* getShapeInfo() const { return m_info; }
+
+private:
+    const ShapeInfo* m_info;
+    int m_x = 0, m_y = 0;
+    Rot m_rot = ROT0;
+};
+
+// Small fast PRNG (PCG32): 16 bytes of state against std::mt19937's ~2.5KB,
+// which matters when the server mode hosts hundreds of generators.
+class Pcg32 {
+public:
+    explicit Pcg32(uint64_t seed) : m_state(0), m_inc((seed << 1u) | 1u) {
+        next();
+        m_state += seed;
+        next();
+    }
+
+    uint32_t next() {
+        const uint64_t old = m_state;
+        m_state = old * 6364136223846793005ULL + m_inc;
+        const uint32_t xorshifted =
+            static_cast<uint32_t>(((old >> 18u) ^ old) >> 27u);
+        const uint32_t rot = static_cast<uint32_t>(old >> 59u);
+        return (xorshifted >> rot) | (xorshifted << ((-rot) & 31u));
+    }
+
+    // Unbiased draw from [0, bound) by rejection (no modulo bias)
+    uint32_t nextBounded(uint32_t bound) {
+        const uint32_t threshold = (-bound) % bound;
+        while (true) {
+            const uint32_t r = next();
+            if (threshold <= r) {
+                return r % bound;
+            }
+        }
+    }
+
+    // Raw state for snapshotting
+    void getState(uint64_t* state, uint64_t* inc) const {
+        *state = m_state;
+        *inc = m_inc;
+    }
+    void setState(uint64_t state, uint64_t inc) {
+        m_state = state;
+        m_inc = inc;
+    }
+
+private:
+    uint64_t m_state, m_inc;
+};
+
+class RandomBlockGenerator {
+public:
+    RandomBlockGenerator(int x, int y)
+        : RandomBlockGenerator(x, y, std::random_device()()) {}
+    // Seedable for deterministic re-simulation (replays, tests)
+    RandomBlockGenerator(int x, int y, uint32_t seed)
+        : m_x(x), m_y(y), m_rng(seed) {
+        refillBag();
+    }
+
+    // Hand out the next piece of the 7-bag sequence at the spawn pose.
+    // Blocks are plain values now, so a spawn is a stack construction with
+    // no heap traffic at all.
+    Block operator()() {
+        if (m_bag_rest == 0) {
+            refillBag();
+        }
+        return makeBlock(m_bag[--m_bag_rest]);
+    }
+
+    // Full mutable generator state, snapshot-friendly POD
+    struct State {
+        uint64_t rng_state, rng_inc;
+        uint8_t bag[7];
+        uint8_t bag_rest;
+    };
+
+    State getState() const {
+        State state;
+        m_rng.getState(&state.rng_state, &state.rng_inc);
+        std::memcpy(state.bag, m_bag, sizeof(m_bag));
+        state.bag_rest = static_cast<uint8_t>(m_bag_rest);
+        return state;
+    }
+
+    void setState(const State& state) {
+        m_rng.setState(state.rng_state, state.rng_inc);
+        std::memcpy(m_bag, state.bag, sizeof(m_bag));
+        m_bag_rest = state.bag_rest;
+    }
+
+    // Block of a given shape at the spawn pose (snapshot restore)
+    Block makeBlock(int shape_id) const {
+        Block block(shape_id);
+        block.setPose({m_x, m_y, Block::ROT0});
+        return block;
+    }
+
+private:
+    // Standard 7-bag: each batch is a Fisher-Yates shuffle of all 7 shapes
+    void refillBag() {
+        for (uint8_t i = 0; i < 7; i++) {
+            m_bag[i] = i;
+        }
+        for (uint32_t i = 6; 0 < i; i--) {
+            std::swap(m_bag[i], m_bag[m_rng.nextBounded(i + 1)]);
+        }
+        m_bag_rest = 7;
+    }
+
+    int m_x, m_y;
+    Pcg32 m_rng;
+    uint8_t m_bag[7];
+    int m_bag_rest = 0;
+};
+
+class BlockMap {
+public:
+    BlockMap() {}
+    BlockMap(size_t w, size_t h)
+        : m_w(w),
+          m_h(h),
+          m_stride_shift(CeilLog2(w)),
+          m_stride(size_t(1) << m_stride_shift),
+          m_words_per_row((w + 63) / 64),
+          m_blocks(m_stride * h, Color::BLACK),
+          m_row_bits(m_words_per_row * h, 0),
+          m_row_fill(h, 0),
+          m_row_slot(h),
+          m_col_heights(w, 0),
+          m_col_fill(w, 0) {
+        // Rows live in a ring of physical slots behind this indirection:
+        // deleting or inserting a row is an index rotation, never a cell
+        // copy, while each row stays contiguous for the renderer and the
+        // SIMD scans
+        for (size_t y = 0; y < h; y++) {
+            m_row_slot[y] = static_cast<uint32_t>(y);
+        }
+    }
+
+    bool exist(int x, int y) const {
+        return (m_row_bits[m_row_slot[y] * m_words_per_row + (x >> 6)] >>
+                (x & 63)) &
+               uint64_t(1);
+    }
+
+    bool isPuttable(const Block& block) const {
+        TETRIS_TRACE_SCOPE(TRACE_IS_PUTTABLE);
+        const Block::Pose pose = block.getPose();
+        const ShapeInfo& si = *block.getShapeInfo();
+        const ShapeInfo::RotInfo& ri = si.rots[pose.rot];
+
+        // Walls and floor collapse to three compares against the
+        // precomputed legal pose ranges of this (shape, rotation)
+        if (pose.x < ri.min_x ||
+            static_cast<int>(m_w) - ri.max_x_off < pose.x ||
+            static_cast<int>(m_h) - ri.max_y_off < pose.y) {
+            return false;
+        }
+
+        // Overlap: AND each occupied row's mask with the field words
+        const int base = pose.x - si.w_l;
+        const int base_y = pose.y - si.h_l;
+        for (int cy = ri.cy0; cy <= ri.cy1; cy++) {
+            const int y = base_y + cy;
+            // Above the field (spawn overhang), or above every column top
+            if (y < static_cast<int>(m_h) - m_max_height) {
+                continue;
+            }
+            const uint64_t bits = ri.row_bits[cy];
+            // Cells left of column 0 are impossible here (the wall check
+            // passed), so the shifted-out bits are guaranteed zero
+            const int base0 = std::max(base, 0);
+            const uint64_t row_bits = (base < 0) ? (bits >> -base) : bits;
+            const uint64_t* words =
+                &m_row_bits[m_row_slot[y] * m_words_per_row];
+            const int word_idx = base0 >> 6;
+            const int shift = base0 & 63;
+            uint64_t field = words[word_idx] >> shift;
+            if (shift != 0 &&
+                word_idx + 1 < static_cast<int>(m_words_per_row)) {
+                field |= words[word_idx + 1] << (64 - shift);
+            }
+            if (row_bits & field) {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // Rows the block can fall before it rests, in O(block width) from the
+    // column height cache. Also the landing row for the ghost preview and
+    // the hard-drop primitive placement search builds on.
+    int dropDistance(const Block& block) const {
+        int sx, sy, ex, ey;
+        block.getRange(&sx, &sy, &ex, &ey);
+        bool below_top = false;
+        int dist = static_cast<int>(m_h);
+        for (int x = std::max(sx, 0);
+             x <= ex && x < static_cast<int>(m_w); x++) {
+            int bottom_y;
+            if (!block.getColumnBottom(x, &bottom_y)) {
+                continue;
+            }
+            // First filled row of this column (m_h when the column is empty)
+            const int stack_top = static_cast<int>(m_h) - m_col_heights[x];
+            if (stack_top <= bottom_y) {
+                below_top = true;  // Tucked under an overhang
+                break;
+            }
+            dist = std::min(dist, stack_top - 1 - bottom_y);
+        }
+        if (!below_top) {
+            return dist;
+        }
+        // Rare slow path: the block already sits below a column top, where
+        // the height cache alone cannot answer. Probe row by row.
+        dist = 0;
+        while (true) {
+            bool collides = false;
+            for (int y = sy; y <= ey && !collides; y++) {
+                const uint16_t bits = block.getRowBits(y);
+                if (bits == 0) {
+                    continue;
+                }
+                const int ty = y + dist + 1;
+                if (ty < 0) {
+                    continue;
+                }
+                if (static_cast<int>(m_h) <= ty) {
+                    collides = true;
+                    break;
+                }
+                for (int i = 0; (bits >> i) != 0; i++) {
+                    if (((bits >> i) & 1) && exist(sx + i, ty)) {
+                        collides = true;
+                        break;
+                    }
+                }
+            }
+            if (collides) {
+                return dist;
+            }
+            dist++;
+        }
+    }
+
+    void putBlock(const Block& block) {
+        TETRIS_TRACE_SCOPE(TRACE_PUT_BLOCK);
+        // Existing range
+        int sx, sy, ex, ey;
+        block.getRange(&sx, &sy, &ex, &ey);
+        sx = std::max(0, sx);
+        sy = std::max(0, sy);
+        ex = std::min(static_cast<int>(m_w) - 1, ex);
+        ey = std::min(static_cast<int>(m_h) - 1, ey);
+
+        // Put
+        const Color col = block.getColor();
+        for (int y = sy; y <= ey; y++) {
+            for (int x = sx; x <= ex; x++) {
+                if (block.exist(x, y)) {
+                    setCell(x, y, col);
+                }
+            }
+        }
+    }
+
+    int eraseFilledLines() { return eraseFilledLinesImpl(nullptr); }
+
+    // Aggregate board features for placement scoring, computed from the
+    // per-column height and fill counters alone - no cell reads, O(w).
+    // Holes fall out of the counters directly: every cell under a column
+    // top that is not occupied is a hole, so holes = height - fill.
+    struct EvalFeatures {
+        int total_height = 0;
+        int n_holes = 0;
+        int bumpiness = 0;       // Sum of adjacent height differences
+        int max_well_depth = 0;  // Deepest drop below both neighbours
+    };
+
+    EvalFeatures evalFeatures() const {
+        EvalFeatures f;
+        for (int x = 0; x < static_cast<int>(m_w); x++) {
+            const int height = m_col_heights[x];
+            f.total_height += height;
+            f.n_holes += height - m_col_fill[x];
+            const int left =
+                (x == 0) ? static_cast<int>(m_h) : m_col_heights[x - 1];
+            const int right = (x == static_cast<int>(m_w) - 1)
+                                  ? static_cast<int>(m_h)
+                                  : m_col_heights[x + 1];
+            if (0 < x) {
+                f.bumpiness += std::abs(height - left);
+            }
+            f.max_well_depth =
+                std::max(f.max_well_depth, std::min(left, right) - height);
+        }
+        return f;
+    }
+
+    // Everything undoPlacement() needs to reverse one placeBlock(). The
+    // buffers are reused across calls, so a searcher keeps one per worker
+    // (or a small stack of them for lookahead trees) and performs no
+    // per-candidate allocation after warmup.
+    struct PlacementUndo {
+        struct Cell {
+            int16_t x, y;
+        };
+        Cell cells[16];    // Piece cells written by the put
+        int n_cells = 0;
+        int16_t row_y[4];  // Logical row of each erased line, in erase order
+        int n_rows = 0;
+        std::vector<Color> row_colors;      // n_rows * w erased-cell colors
+        std::vector<uint16_t> col_heights;  // Counter snapshots
+        std::vector<uint16_t> col_fill;
+        int max_height = 0;
+    };
+
+    // Reversible lock for placement search: putBlock + eraseFilledLines
+    // recording what the inverse needs. Forward and reverse both cost
+    // O(piece cells + w), so a searcher scores candidates in place on one
+    // field instead of copying it per candidate.
+    int placeBlock(const Block& block, PlacementUndo& undo) {
+        undo.col_heights.assign(m_col_heights.begin(), m_col_heights.end());
+        undo.col_fill.assign(m_col_fill.begin(), m_col_fill.end());
+        undo.max_height = m_max_height;
+        undo.n_cells = 0;
+        undo.n_rows = 0;
+        undo.row_colors.clear();
+
+        int sx, sy, ex, ey;
+        block.getRange(&sx, &sy, &ex, &ey);
+        sx = std::max(0, sx);
+        sy = std::max(0, sy);
+        ex = std::min(static_cast<int>(m_w) - 1, ex);
+        ey = std::min(static_cast<int>(m_h) - 1, ey);
+        const Color col = block.getColor();
+        for (int y = sy; y <= ey; y++) {
+            for (int x = sx; x <= ex; x++) {
+                if (block.exist(x, y)) {
+                    undo.cells[undo.n_cells].x = static_cast<int16_t>(x);
+                    undo.cells[undo.n_cells].y = static_cast<int16_t>(y);
+                    undo.n_cells++;
+                    setCell(x, y, col);
+                }
+            }
+        }
+        return eraseFilledLinesImpl(&undo);
+    }
+
+    void undoPlacement(const PlacementUndo& undo) {
+        // Reverse the line-clear rotations, newest first: the recycled top
+        // slot returns to its logical row with its pre-clear contents
+        for (int i = undo.n_rows - 1; 0 <= i; i--) {
+            const int y = undo.row_y[i];
+            const uint32_t slot = m_row_slot[0];
+            std::memmove(&m_row_slot[0], &m_row_slot[1],
+                         y * sizeof(uint32_t));
+            m_row_slot[y] = slot;
+            Color* row = &m_blocks[size_t(slot) << m_stride_shift];
+            uint64_t* bits = &m_row_bits[slot * m_words_per_row];
+            std::memcpy(row, &undo.row_colors[size_t(i) * m_w],
+                        m_w * sizeof(Color));
+            for (size_t x = 0; x < m_w; x++) {
+                bits[x >> 6] |= uint64_t(1) << (x & 63);
+            }
+            m_row_fill[slot] = static_cast<uint16_t>(m_w);
+        }
+        // Clear the piece cells with raw stores (a cell inside a restored
+        // row was restored occupied, so the fill decrement is right); the
+        // column counters come back wholesale from the snapshot below
+        for (int i = 0; i < undo.n_cells; i++) {
+            const int x = undo.cells[i].x;
+            const int y = undo.cells[i].y;
+            const uint32_t slot = m_row_slot[y];
+            m_blocks[(size_t(slot) << m_stride_shift) + x] = Color::BLACK;
+            m_row_bits[slot * m_words_per_row + (x >> 6)] &=
+                ~(uint64_t(1) << (x & 63));
+            m_row_fill[slot]--;
+        }
+        std::memcpy(m_col_heights.data(), undo.col_heights.data(),
+                    m_w * sizeof(uint16_t));
+        std::memcpy(m_col_fill.data(), undo.col_fill.data(),
+                    m_w * sizeof(uint16_t));
+        m_max_height = undo.max_height;
+    }
+
+private:
+    int eraseFilledLinesImpl(PlacementUndo* undo) {
+        TETRIS_TRACE_SCOPE(TRACE_ERASE_LINES);
+        int n_erased_lines = 0;
+        for (int y = m_h - 1; 0 <= y; y--) {
+            const uint32_t slot = m_row_slot[y];
+            // Filled-line detection is one compare of the row's fill count
+            if (m_row_fill[slot] != m_w) {
+                continue;
+            }
+            if (undo) {
+                undo->row_y[undo->n_rows++] = static_cast<int16_t>(y);
+                const Color* row = &m_blocks[size_t(slot) << m_stride_shift];
+                undo->row_colors.insert(undo->row_colors.end(), row,
+                                        row + m_w);
+            }
+            n_erased_lines++;
+            // Rotate the row ring: everything above slides down one index
+            // entry and the cleared slot is recycled as the new top row -
+            // O(h) index moves, no cell copies
+            std::memmove(&m_row_slot[1], &m_row_slot[0],
+                         y * sizeof(uint32_t));
+            m_row_slot[0] = slot;
+            std::memset(&m_blocks[size_t(slot) << m_stride_shift], 0,
+                        m_w * sizeof(Color));
+            std::memset(&m_row_bits[slot * m_words_per_row], 0,
+                        m_words_per_row * sizeof(uint64_t));
+            m_row_fill[slot] = 0;
+            // Check current line again
+            y++;
+        }
+        if (0 < n_erased_lines) {
+            // Column tops can only move down; rescan each from its old top.
+            // Every erased row was full, so each column lost exactly one
+            // occupied cell per line.
+            m_max_height = 0;
+            for (size_t x = 0; x < m_w; x++) {
+                recomputeColumn(x);
+                m_col_fill[x] =
+                    static_cast<uint16_t>(m_col_fill[x] - n_erased_lines);
+                m_max_height = std::max(m_max_height,
+                                        static_cast<int>(m_col_heights[x]));
+            }
+        }
+        return n_erased_lines;
+    }
+
+public:
+    // Insert `n` garbage rows at the bottom (filled except the `hole_x`
+    // column): the whole stack rises by one ring rotation - the freed top
+    // slots become the garbage rows - and column heights update
+    // analytically in O(w). Returns false when occupied cells were pushed
+    // past the ceiling (top-out).
+    bool insertGarbageRows(int n, int hole_x, Color col = Color::WHITE) {
+        n = std::min(n, static_cast<int>(m_h));
+        bool overflow = false;
+        for (int y = 0; y < n && !overflow; y++) {
+            overflow = (m_row_fill[m_row_slot[y]] != 0);
+        }
+        // Logical rows drop by n; the old top slots rotate to the bottom
+        std::rotate(m_row_slot.begin(), m_row_slot.begin() + n,
+                    m_row_slot.end());
+        // Compose the garbage rows into the recycled slots
+        for (int i = 0; i < n; i++) {
+            const uint32_t slot = m_row_slot[m_h - n + i];
+            Color* row = &m_blocks[size_t(slot) << m_stride_shift];
+            uint64_t* bits = &m_row_bits[slot * m_words_per_row];
+            std::memset(row, 0, m_w * sizeof(Color));
+            std::memset(bits, 0, m_words_per_row * sizeof(uint64_t));
+            for (size_t x = 0; x < m_w; x++) {
+                if (static_cast<int>(x) != hole_x) {
+                    row[x] = col;
+                    bits[x >> 6] |= uint64_t(1) << (x & 63);
+                }
+            }
+            m_row_fill[slot] = static_cast<uint16_t>(m_w - 1);
+        }
+        // Every column's top rises by n; empty columns gain the garbage
+        // height unless they are the hole. On overflow cells were dropped
+        // past the ceiling, so the analytic update does not hold - rescan.
+        m_max_height = 0;
+        for (size_t x = 0; x < m_w; x++) {
+            if (overflow) {
+                m_col_heights[x] = static_cast<uint16_t>(m_h);
+                recomputeColumn(x);
+                uint16_t fill = 0;
+                for (size_t y = 0; y < m_h; y++) {
+                    fill = static_cast<uint16_t>(fill + exist(x, y));
+                }
+                m_col_fill[x] = fill;
+            } else {
+                const int h_old = m_col_heights[x];
+                const int h_new =
+                    (0 < h_old) ? h_old + n
+                                : ((static_cast<int>(x) == hole_x) ? 0 : n);
+                m_col_heights[x] = static_cast<uint16_t>(h_new);
+                if (static_cast<int>(x) != hole_x) {
+                    m_col_fill[x] = static_cast<uint16_t>(m_col_fill[x] + n);
+                }
+            }
+            m_max_height = std::max(m_max_height,
+                                    static_cast<int>(m_col_heights[x]));
+        }
+        return !overflow;
+    }
+
+    size_t width() const { return m_w; }
+    size_t height() const { return m_h; }
+    Color getColor(int x, int y) const { return get(x, y); }
+
+    // Cells above (m_h - height) of a column are all empty
+    int getColumnHeight(int x) const { return m_col_heights[x]; }
+    int getMaxHeight() const { return m_max_height; }
+
+    // FNV-1a over the cell colors in logical row order: hashing through the
+    // slot indirection makes two boards that agree cell-for-cell agree here
+    // regardless of how their physical rings are rotated
+    uint64_t stateHash() const {
+        uint64_t hash = 14695981039346656037ull;
+        for (size_t y = 0; y < m_h; y++) {
+            const Color* row =
+                &m_blocks[size_t(m_row_slot[y]) << m_stride_shift];
+            for (size_t x = 0; x < m_w; x++) {
+                hash = (hash ^ static_cast<uint8_t>(row[x])) *
+                       1099511628211ull;
+            }
+        }
+        return hash;
+    }
+
+    void setCell(int x, int y, Color col) {
+        // Keep the color array, occupancy bits, row/column fill counts and
+        // column heights in sync
+        const bool was_occupied = exist(x, y);
+        const uint32_t slot = m_row_slot[y];
+        m_blocks[(size_t(slot) << m_stride_shift) + x] = col;
+        uint64_t& word = m_row_bits[slot * m_words_per_row + (x >> 6)];
+        if (col != Color::BLACK) {
+            word |= uint64_t(1) << (x & 63);
+            if (!was_occupied) {
+                m_row_fill[slot]++;
+                m_col_fill[x]++;
+                const int height = m_h - y;
+                if (m_col_heights[x] < height) {
+                    m_col_heights[x] = height;
+                    m_max_height = std::max(m_max_height, height);
+                }
+            }
+        } else {
+            word &= ~(uint64_t(1) << (x & 63));
+            if (was_occupied) {
+                m_row_fill[slot]--;
+                m_col_fill[x]--;
+                if (static_cast<int>(m_h) - y == m_col_heights[x]) {
+                    // The column top was cleared
+                    recomputeColumn(x);
+                    recomputeMaxHeight();
+                }
+            }
+        }
+    }
+
+private:
+    constexpr static size_t CeilLog2(size_t v) {
+        size_t shift = 0;
+        while ((size_t(1) << shift) < v) {
+            shift++;
+        }
+        return shift;
+    }
+
+    const Color& get(int x, int y) const {
+        // Power-of-two row stride: indexing is shift+add, no multiply
+        return m_blocks[(size_t(m_row_slot[y]) << m_stride_shift) + x];
+    }
+
+    void recomputeColumn(int x) {
+        // The new top is never above the old one, so resume from there
+        int y = std::max(0, static_cast<int>(m_h) - m_col_heights[x]);
+        while (y < static_cast<int>(m_h) && !exist(x, y)) {
+            y++;
+        }
+        m_col_heights[x] = m_h - y;
+    }
+
+    void recomputeMaxHeight() {
+        m_max_height = 0;
+        for (size_t x = 0; x < m_w; x++) {
+            m_max_height =
+                std::max(m_max_height, static_cast<int>(m_col_heights[x]));
+        }
+    }
+
+    size_t m_w, m_h;
+    size_t m_stride_shift, m_stride;  // Row stride of the color array
+    size_t m_words_per_row;           // 64-bit mask words per row
+    std::vector<Color> m_blocks;
+    std::vector<uint64_t> m_row_bits;    // Occupancy bitmask per row
+    std::vector<uint16_t> m_row_fill;    // Occupied-cell count per slot
+    std::vector<uint32_t> m_row_slot;    // Logical row -> physical slot
+    std::vector<uint16_t> m_col_heights; // Height of each column's top
+    std::vector<uint16_t> m_col_fill;    // Occupied-cell count per column
+    int m_max_height = 0;
+};
+
+template <typename Action, typename... Args>
+bool TryBlockAction(Block& block, const BlockMap& block_map, Action action,
+                    Args&&... args) {
+    TETRIS_TRACE_SCOPE(TRACE_TRY_ACTION);
+    // Snapshot the pose on the stack and act in place (no clone, no heap)
+    const Block::Pose pose_org = block.getPose();
+    (block.*action)(std::forward<Args>(args)...);
+    // Check
+    if (block_map.isPuttable(block)) {
+        return true;
+    } else {
+        // Restore the original pose
+        block.setPose(pose_org);
+        return false;
+    }
+}
+
+// One game input per step() call. TICK is the gravity event which the caller
+// schedules (the interactive frontend fires it from its event clock, headless
+// drivers fire it as fast as they like).
+enum class Input : char { NONE, ROTATE, LEFT, RIGHT, DOWN, TICK, DROP };
+
+class TetrisEngine {
+public:
+    TetrisEngine(size_t w, size_t h)
+        : TetrisEngine(w, h, std::random_device()()) {}
+    // The whole game is deterministic given the seed and the input stream
+    TetrisEngine(size_t w, size_t h, uint32_t seed)
+        : m_block_map(w, h), m_rand_block_gen(w / 2, 0, seed), m_seed(seed) {
+        m_block = m_rand_block_gen();
+    }
+
+    // Apply one input. Returns false once the game is over.
+    bool step(Input input) {
+        if (m_game_over) {
+            return false;
+        }
+        switch (input) {
+            case Input::NONE:
+                break;
+            case Input::ROTATE:
+                TryBlockAction(m_block, m_block_map, &Block::rotate);
+                break;
+            case Input::LEFT:
+                TryBlockAction(m_block, m_block_map, &Block::move, -1, 0);
+                break;
+            case Input::RIGHT:
+                TryBlockAction(m_block, m_block_map, &Block::move, 1, 0);
+                break;
+            case Input::DOWN:
+                TryBlockAction(m_block, m_block_map, &Block::move, 0, 1);
+                break;
+            case Input::TICK:
+                // Go down, or lock the block and spawn the next one
+                if (!TryBlockAction(m_block, m_block_map, &Block::move, 0,
+                                    1)) {
+                    lockBlock();
+                }
+                break;
+            case Input::DROP:
+                // Teleport to the landing row and lock immediately
+                m_block.move(0, m_block_map.dropDistance(m_block));
+                lockBlock();
+                break;
+        }
+        return !m_game_over;
+    }
+
+    // Versus mode: garbage rows from the opponent rise from the floor. The
+    // falling block is lifted out of the rising stack when needed; cells
+    // pushed past the ceiling end the game.
+    void addGarbage(int n, int hole_x) {
+        if (m_game_over || n <= 0) {
+            return;
+        }
+        if (!m_block_map.insertGarbageRows(n, hole_x)) {
+            m_game_over = true;
+            return;
+        }
+        for (int i = 0; i < n && !m_block_map.isPuttable(m_block); i++) {
+            m_block.move(0, -1);
+        }
+        m_game_over = !m_block_map.isPuttable(m_block);
+    }
+
+    bool isGameOver() const { return m_game_over; }
+    uint32_t getSeed() const { return m_seed; }
+    int getNumErasedLines() const { return m_n_erased_lines; }
+
+    // Digest of the whole deterministic state - field, falling block,
+    // generator, score - for lockstep desync detection: two engines fed
+    // identical input streams from the same seed hash equal after every step
+    uint64_t stateHash() const {
+        const Block::Pose pose = m_block.getPose();
+        const RandomBlockGenerator::State gen = m_rand_block_gen.getState();
+        uint64_t hash = m_block_map.stateHash();
+        const uint64_t parts[] = {static_cast<uint64_t>(m_block.getShapeId()),
+                                  static_cast<uint64_t>(pose.x),
+                                  static_cast<uint64_t>(pose.y),
+                                  static_cast<uint64_t>(pose.rot),
+                                  static_cast<uint64_t>(m_n_erased_lines),
+                                  static_cast<uint64_t>(m_game_over),
+                                  gen.rng_state,
+                                  gen.rng_inc,
+                                  gen.bag_rest};
+        for (const uint64_t part : parts) {
+            hash = (hash ^ part) * 1099511628211ull;
+        }
+        return hash;
+    }
+
+    // --- Snapshot support (see tetris_snapshot.h) ---
+    const RandomBlockGenerator& getGenerator() const {
+        return m_rand_block_gen;
+    }
+    void restore(const Color* cells, int block_shape,
+                 const Block::Pose& pose,
+                 const RandomBlockGenerator::State& gen_state,
+                 int n_erased_lines, bool game_over) {
+        for (size_t y = 0; y < m_block_map.height(); y++) {
+            for (size_t x = 0; x < m_block_map.width(); x++) {
+                m_block_map.setCell(x, y, cells[y * m_block_map.width() + x]);
+            }
+        }
+        m_rand_block_gen.setState(gen_state);
+        m_block = m_rand_block_gen.makeBlock(block_shape);
+        m_block.setPose(pose);
+        m_n_erased_lines = n_erased_lines;
+        m_game_over = game_over;
+    }
+    // Settled field only; the falling block is not painted into it
+    const BlockMap& getBlockMap() const { return m_block_map; }
+    const Block& getBlock() const { return m_block; }
+
+private:
+    // Settle the falling block into the field and spawn the next one
+    void lockBlock() {
+        m_block_map.putBlock(m_block);
+        m_n_erased_lines += m_block_map.eraseFilledLines();
+        m_block = m_rand_block_gen();
+        m_game_over = !m_block_map.isPuttable(m_block);
+    }
+
+    BlockMap m_block_map;
+    RandomBlockGenerator m_rand_block_gen;
+    uint32_t m_seed;
+    Block m_block;
+    int m_n_erased_lines = 0;
+    bool m_game_over = false;
+};
+
+#endif  // TETRIS_ENGINE_H
@@ -0,0 +1,181 @@
+#ifndef TETRIS_LOCKSTEP_H
+#define TETRIS_LOCKSTEP_H
+
+// Deterministic lockstep netplay building blocks. Both ends run both
+// engines from a shared seed and exchange one 6-byte input packet per tick
+// instead of rendered frames; a configurable input-delay pipeline gives
+// each packet a full round trip of budget before the simulation needs it,
+// and periodic state-hash packets bound how long a divergence can go
+// unnoticed. Everything here is transport-agnostic: the frontend owns the
+// socket and pushes received bytes through LockstepDecoder.
+
+#include <algorithm>
+#include <cstdint>
+#include <cstring>
+#include <vector>
+
+#include "tetris_engine.h"
+
+enum LockstepMsgType : uint8_t {
+    LOCKSTEP_HELLO = 1,  // Host -> joiner: session parameters
+    LOCKSTEP_INPUT = 2,  // One per tick per side, Input::NONE included
+    LOCKSTEP_HASH = 3,   // Periodic TetrisEngine::stateHash digest
+};
+
+struct LockstepHello {
+    uint8_t type;
+    uint8_t delay;  // Input-delay pipeline depth in ticks
+    uint16_t w, h;
+    uint32_t seed;  // Host engine seed; the joiner's engine uses seed + 1
+} __attribute__((packed));
+
+struct LockstepInput {
+    uint8_t type;
+    uint8_t input;  // Input value, executed at `tick`
+    uint32_t tick;
+} __attribute__((packed));
+
+struct LockstepHash {
+    uint8_t type;
+    uint8_t pad[3];
+    uint32_t tick;
+    uint64_t hash;  // Sender's own engine after executing `tick`
+} __attribute__((packed));
+
+// Ticks between hash packets: 16 bytes every couple of seconds at the
+// default tick rate, so a desync is caught about that fast
+constexpr uint32_t LOCKSTEP_HASH_INTERVAL = 64;
+
+inline size_t LockstepMsgSize(uint8_t type) {
+    switch (type) {
+        case LOCKSTEP_HELLO: return sizeof(LockstepHello);
+        case LOCKSTEP_INPUT: return sizeof(LockstepInput);
+        case LOCKSTEP_HASH: return sizeof(LockstepHash);
+        default: return 0;
+    }
+}
+
+// The input-delay pipeline: a key sampled while simulating tick T is
+// scheduled (and sent) for tick T + delay, and a tick may only execute once
+// the remote input for it has arrived. Slots are append-only byte vectors
+// indexed by tick; an hour of play holds ~100KB.
+class InputPipeline {
+public:
+    // A depth below one tick cannot work (each side waits for the remote
+    // input of a tick before sending its own), so clamp whatever the CLI
+    // or a peer's HELLO handed us
+    explicit InputPipeline(int delay) : m_delay(std::max(1, delay)) {
+        // The first `delay` ticks precede any sampled input, on both
+        // sides: without the remote prefill each peer would wait for the
+        // other's tick-0 packet before sending its own and neither match
+        // could ever start
+        m_local.resize(m_delay, static_cast<uint8_t>(Input::NONE));
+        m_remote.resize(m_delay, static_cast<uint8_t>(Input::NONE));
+    }
+
+    // Record the local input sampled at `now_tick` and return the packet to
+    // send (both sides schedule it `delay` ticks ahead)
+    LockstepInput scheduleLocal(uint32_t now_tick, Input input) {
+        m_local.push_back(static_cast<uint8_t>(input));
+        LockstepInput msg{};
+        msg.type = LOCKSTEP_INPUT;
+        msg.input = static_cast<uint8_t>(input);
+        msg.tick = now_tick + static_cast<uint32_t>(m_delay);
+        return msg;
+    }
+
+    void pushRemote(const LockstepInput& msg) {
+        // The peer's pre-pipeline ticks are implicit NONE, the same rule as
+        // the local side; anything at or below the watermark is a duplicate
+        while (m_remote.size() < msg.tick) {
+            m_remote.push_back(static_cast<uint8_t>(Input::NONE));
+        }
+        if (m_remote.size() == msg.tick) {
+            m_remote.push_back(msg.input);
+        }
+    }
+
+    // Tick `tick` may execute only once both inputs for it are known
+    bool remoteReady(uint32_t tick) const { return tick < m_remote.size(); }
+
+    Input localAt(uint32_t tick) const {
+        return static_cast<Input>(m_local[tick]);
+    }
+    Input remoteAt(uint32_t tick) const {
+        return static_cast<Input>(m_remote[tick]);
+    }
+
+    int delay() const { return m_delay; }
+
+private:
+    int m_delay;
+    std::vector<uint8_t> m_local;   // Input executed at each tick, ours
+    std::vector<uint8_t> m_remote;  // ... and the peer's
+};
+
+// Small window of per-tick digests awaiting the matching digest from the
+// other side (either side can reach a hash tick first)
+class LockstepHashLog {
+public:
+    void push(uint32_t tick, uint64_t hash) {
+        m_entries[m_next % WINDOW] = {tick, hash};
+        m_next++;
+    }
+
+    bool take(uint32_t tick, uint64_t* hash) const {
+        for (const Entry& entry : m_entries) {
+            if (entry.tick == tick) {
+                *hash = entry.hash;
+                return true;
+            }
+        }
+        return false;
+    }
+
+private:
+    constexpr static size_t WINDOW = 8;
+
+    struct Entry {
+        uint32_t tick = UINT32_MAX;
+        uint64_t hash = 0;
+    };
+
+    Entry m_entries[WINDOW];
+    size_t m_next = 0;
+};
+
+// Incremental frame decoder for the message stream: buffers partial reads
+// and yields one complete message at a time
+class LockstepDecoder {
+public:
+    void feed(const char* data, size_t n) {
+        m_buf.insert(m_buf.end(), data, data + n);
+    }
+
+    // Copies the next whole message into `out` (sized for the largest) and
+    // returns its type; 0 when more bytes are needed, -1 on a bad stream
+    int next(void* out) {
+        if (m_buf.size() <= m_pos) {
+            m_buf.clear();
+            m_pos = 0;
+            return 0;
+        }
+        const uint8_t type = static_cast<uint8_t>(m_buf[m_pos]);
+        const size_t len = LockstepMsgSize(type);
+        if (len == 0) {
+            return -1;
+        }
+        if (m_buf.size() - m_pos < len) {
+            return 0;
+        }
+        std::memcpy(out, &m_buf[m_pos], len);
+        m_pos += len;
+        return type;
+    }
+
+private:
+    std::vector<char> m_buf;
+    size_t m_pos = 0;
+};
+
+#endif  // TETRIS_LOCKSTEP_H
@@ -0,0 +1,156 @@
+#ifndef TETRIS_PERF_H
+#define TETRIS_PERF_H
+
+// Frame timing instrumentation: each loop phase (kernel wait, logic, draw)
+// is timestamped into a fixed-size lock-free ring buffer. The hot path does
+// no allocation and no I/O; the HUD line and the on-exit p50/p99/max and
+// jitter dump read the ring afterwards.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+class FrameProfiler {
+public:
+    enum Phase { WAIT = 0, LOGIC, DRAW, N_PHASES };
+
+    struct Record {
+        uint32_t phase_ns[N_PHASES];
+        uint32_t missed_ticks;  // Gravity deadlines serviced late this frame
+        uint32_t total_ns() const {
+            return phase_ns[WAIT] + phase_ns[LOGIC] + phase_ns[DRAW];
+        }
+    };
+
+    FrameProfiler() { m_write_idx.store(0, std::memory_order_relaxed); }
+
+    void beginFrame() {
+        m_phase_start = now();
+        m_curr = Record{};
+    }
+
+    // Close the current phase and start the next one
+    void markPhase(Phase phase) {
+        const uint64_t t = now();
+        m_curr.phase_ns[phase] =
+            static_cast<uint32_t>(std::min<uint64_t>(t - m_phase_start,
+                                                     UINT32_MAX));
+        m_phase_start = t;
+    }
+
+    // Gravity deadlines that expired before the loop got to service them
+    // (the timerfd reports the overrun count on read). Recorded into the
+    // current frame and a session-wide total.
+    void noteMissedTicks(uint32_t n) {
+        m_curr.missed_ticks += n;
+        m_n_missed_total += n;
+    }
+
+    void endFrame() {
+        const uint64_t idx = m_write_idx.load(std::memory_order_relaxed);
+        m_ring[idx & RING_MASK] = m_curr;
+        m_write_idx.store(idx + 1, std::memory_order_release);
+    }
+
+    // One-line summary of the last frames, suitable for a HUD
+    std::string makeHudLine() const {
+        const uint64_t n = m_write_idx.load(std::memory_order_acquire);
+        if (n == 0) {
+            return "";
+        }
+        const size_t n_recent = static_cast<size_t>(std::min<uint64_t>(n, 32));
+        uint64_t logic_ns = 0, draw_ns = 0, total_ns = 0;
+        for (size_t i = 0; i < n_recent; i++) {
+            const Record& r = m_ring[(n - 1 - i) & RING_MASK];
+            logic_ns += r.phase_ns[LOGIC];
+            draw_ns += r.phase_ns[DRAW];
+            total_ns += r.total_ns();
+        }
+        char buf[128];
+        std::snprintf(buf, sizeof(buf),
+                      "logic %5.1fus  draw %5.1fus  frame %7.1fus  miss %llu",
+                      logic_ns / 1000.0 / n_recent,
+                      draw_ns / 1000.0 / n_recent,
+                      total_ns / 1000.0 / n_recent,
+                      static_cast<unsigned long long>(m_n_missed_total));
+        return buf;
+    }
+
+    // Dump percentiles and a jitter histogram of the recorded frames
+    void dumpStats(FILE* out) const {
+        const uint64_t n = m_write_idx.load(std::memory_order_acquire);
+        const size_t n_records =
+            static_cast<size_t>(std::min<uint64_t>(n, RING_SIZE));
+        if (n_records == 0) {
+            return;
+        }
+
+        std::fprintf(out,
+                     "Frame stats (%zu frames recorded, %llu deadline "
+                     "misses)\n",
+                     n_records,
+                     static_cast<unsigned long long>(m_n_missed_total));
+        static const char* PHASE_NAMES[N_PHASES] = {"wait", "logic", "draw"};
+        std::vector<uint32_t> samples(n_records);
+        for (int phase = 0; phase <= N_PHASES; phase++) {
+            for (size_t i = 0; i < n_records; i++) {
+                const Record& r = m_ring[(n - 1 - i) & RING_MASK];
+                samples[i] = (phase < N_PHASES)
+                                 ? r.phase_ns[phase]
+                                 : r.total_ns();
+            }
+            std::sort(samples.begin(), samples.end());
+            const char* name = (phase < N_PHASES) ? PHASE_NAMES[phase]
+                                                  : "frame";
+            std::fprintf(out,
+                         "  %-5s p50 %8.1fus  p99 %8.1fus  max %8.1fus\n",
+                         name, samples[n_records / 2] / 1000.0,
+                         samples[n_records * 99 / 100] / 1000.0,
+                         samples[n_records - 1] / 1000.0);
+        }
+
+        // Jitter histogram: active (non-wait) time per frame, log2 us buckets
+        std::fprintf(out, "  active-time histogram:\n");
+        constexpr int N_BUCKETS = 12;  // <1us .. >=1s
+        size_t buckets[N_BUCKETS] = {};
+        for (size_t i = 0; i < n_records; i++) {
+            const Record& r = m_ring[(n - 1 - i) & RING_MASK];
+            const uint64_t active_us =
+                (r.phase_ns[LOGIC] + r.phase_ns[DRAW]) / 1000;
+            int b = 0;
+            while (b < N_BUCKETS - 1 && (uint64_t(1) << b) <= active_us) {
+                b++;
+            }
+            buckets[b]++;
+        }
+        for (int b = 0; b < N_BUCKETS; b++) {
+            if (buckets[b] == 0) {
+                continue;
+            }
+            std::fprintf(out, "    <%4luus: %zu\n", (unsigned long)(1) << b,
+                         buckets[b]);
+        }
+    }
+
+private:
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    constexpr static size_t RING_SIZE = 4096;  // Power of two
+    constexpr static uint64_t RING_MASK = RING_SIZE - 1;
+
+    Record m_ring[RING_SIZE];
+    std::atomic<uint64_t> m_write_idx;
+    Record m_curr = {};
+    uint64_t m_phase_start = 0;
+    uint64_t m_n_missed_total = 0;
+};
+
+#endif  // TETRIS_PERF_H
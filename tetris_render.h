@@ -0,0 +1,403 @@
+#ifndef TETRIS_RENDER_H
+#define TETRIS_RENDER_H
+
+// Terminal frame renderer: diffs against the previously drawn frame and
+// emits the whole update with a single write(2). Writes to stdout by
+// default; benchmarks can point it at a sink fd instead.
+
+#include <unistd.h>
+
+#include <condition_variable>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tetris_engine.h"
+
+// Dedicated writer thread with a double-buffered frame handoff: the game
+// loop composes frames and submit() returns immediately, while this thread
+// owns the (possibly blocking) write(2). A stalled terminal or SSH client
+// therefore delays pixels, never gravity or input handling. Back-to-back
+// diffs merge into one pending buffer (one larger write once the channel
+// drains); if a dead peer lets the backlog pile past a cap, the backlog is
+// dropped and the caller repaints from scratch.
+class AsyncFrameWriter {
+public:
+    explicit AsyncFrameWriter(int out_fd) : m_out_fd(out_fd) {
+        m_thread = std::thread([this]() { run(); });
+    }
+
+    ~AsyncFrameWriter() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_stop = true;
+        }
+        m_cv.notify_one();
+        m_thread.join();
+    }
+
+    // Never blocks. Returns false when the backlog was dropped, in which
+    // case the caller must emit a full repaint next frame.
+    bool submit(const std::string& frame) {
+        std::lock_guard<std::mutex> lock(m_mutex);
+        if (MAX_PENDING < m_pending.size()) {
+            m_pending.clear();
+            return false;
+        }
+        m_pending += frame;
+        m_cv.notify_one();
+        return true;
+    }
+
+private:
+    void run() {
+        std::string buf;
+        std::unique_lock<std::mutex> lock(m_mutex);
+        while (true) {
+            m_cv.wait(lock,
+                      [this]() { return m_stop || !m_pending.empty(); });
+            if (m_pending.empty()) {
+                break;  // m_stop and nothing left to drain
+            }
+            // Swap buffers and write unlocked, so the game loop keeps
+            // composing into the other buffer meanwhile
+            buf.swap(m_pending);
+            lock.unlock();
+            const char* data = buf.data();
+            size_t rest = buf.size();
+            while (0 < rest) {
+                const ssize_t n = write(m_out_fd, data, rest);
+                if (n <= 0) {
+                    break;
+                }
+                data += n;
+                rest -= n;
+            }
+            buf.clear();
+            lock.lock();
+        }
+    }
+
+    // A stalled peer may hold ~1MB of diffs before we give up and repaint
+    constexpr static size_t MAX_PENDING = size_t(1) << 20;
+
+    int m_out_fd;
+    std::thread m_thread;
+    std::mutex m_mutex;
+    std::condition_variable m_cv;
+    std::string m_pending;
+    bool m_stop = false;
+};
+
+class ScreenRenderer {
+public:
+    ScreenRenderer(size_t w, size_t h, int out_fd = STDOUT_FILENO)
+        : m_w(w), m_h(h), m_out_fd(out_fd), m_prev_blocks(w * h, 0) {
+        // Reserve for the worst case (full repaint) so steady-state frames
+        // never reallocate
+        m_frame_buf.reserve((w + 2) * (h + 2) * 16 + 64);
+
+        // Precompute the escape string of every color once. When the
+        // terminal advertises 24-bit support, use the nicer truecolor
+        // palette; both ways, per-cell output is a cached memcpy with no
+        // integer formatting.
+        const char* colorterm = getenv("COLORTERM");
+        const bool truecolor =
+            colorterm && (strstr(colorterm, "truecolor") != nullptr ||
+                          strstr(colorterm, "24bit") != nullptr);
+        // {R, G, B} per Color, same order as the enum
+        constexpr static uint8_t PALETTE[8][3] = {
+            {0, 0, 0},       {204, 36, 29},   {104, 157, 0},
+            {214, 93, 14},   {69, 133, 136},  {177, 98, 134},
+            {104, 157, 164}, {235, 219, 178}};
+        for (int c = 0; c < 8; c++) {
+            char esc[32];
+            if (truecolor) {
+                std::snprintf(esc, sizeof(esc), "\e[48;2;%d;%d;%dm",
+                              PALETTE[c][0], PALETTE[c][1], PALETTE[c][2]);
+                m_color_esc[c] = esc;
+                std::snprintf(esc, sizeof(esc), "\e[38;2;%d;%d;%dm",
+                              PALETTE[c][0], PALETTE[c][1], PALETTE[c][2]);
+                m_ghost_esc[c] = esc;
+            } else {
+                std::snprintf(esc, sizeof(esc), "\e[4%dm", c);
+                m_color_esc[c] = esc;
+                std::snprintf(esc, sizeof(esc), "\e[3%dm", c);
+                m_ghost_esc[c] = esc;
+            }
+        }
+
+        // The static frame chrome (clear, walls, score-line prefix) never
+        // changes: compose it once here so a full repaint - including the
+        // very first frame after exec - starts from one memcpy
+        buildStaticChrome();
+    }
+
+    // Draw the settled field with the falling block composited on top as an
+    // overlay; the field itself is neither mutated nor copied. `ghost_dy`,
+    // when positive, is the block's drop distance (BlockMap::dropDistance)
+    // and paints a ghost preview of the landing pose.
+    void draw(const BlockMap& block_map, const Block* block, int point,
+              int ghost_dy = 0) {
+        TETRIS_TRACE_SCOPE(TRACE_DRAW);
+        m_overlay = block;
+        m_ghost_dy = block ? ghost_dy : 0;
+        if (block) {
+            block->getRange(&m_overlay_sx, &m_overlay_sy, &m_overlay_ex,
+                            &m_overlay_ey);
+        }
+        m_frame_buf.clear();
+        m_curr_color = -1;  // Terminal SGR state is default at frame start
+        if (m_first_frame) {
+            drawFullFrame(block_map, point);
+            m_first_frame = false;
+        } else {
+            drawDiffFrame(block_map, point);
+        }
+        // Remember the drawn frame
+        for (size_t y = 0; y < m_h; y++) {
+            for (size_t x = 0; x < m_w; x++) {
+                m_prev_blocks[y * m_w + x] = compositedCell(block_map, x, y);
+            }
+        }
+        m_prev_point = point;
+        // Park the cursor under the field
+        appendResetColor();
+        appendCursorMove(m_h + 4, 1);
+        flushFrame();
+    }
+
+    void draw(const BlockMap& block_map, int point) {
+        draw(block_map, nullptr, point);
+    }
+
+    // Route frame output through a background writer thread (see
+    // AsyncFrameWriter); draw() then never blocks on the terminal
+    void enableAsyncWrites() {
+        m_async_writer = std::make_unique<AsyncFrameWriter>(m_out_fd);
+    }
+
+    // Join the writer thread, draining any pending frames. Output written
+    // directly to the fd (exit-time stats dumps) is ordered after every
+    // submitted frame only once this has returned.
+    void disableAsyncWrites() { m_async_writer.reset(); }
+
+    // Raw trailer bytes (status or HUD lines under the field) through the
+    // same channel as the frames: with async writes enabled a stalled
+    // terminal can then never block the caller
+    void writeRaw(const char* data, size_t n) {
+        if (m_async_writer) {
+            m_async_writer->submit(std::string(data, n));
+            return;
+        }
+        while (0 < n) {
+            const ssize_t written = write(m_out_fd, data, n);
+            if (written <= 0) {
+                break;
+            }
+            data += written;
+            n -= static_cast<size_t>(written);
+        }
+    }
+
+private:
+    // Cell codes: the Color value, with GHOST_BIT set for ghost-preview
+    // cells (drawn as a dim outline rather than a solid cell)
+    constexpr static uint8_t GHOST_BIT = 0x80;
+
+    uint8_t compositedCell(const BlockMap& block_map, int x, int y) const {
+        if (m_overlay && m_overlay_sx <= x && x <= m_overlay_ex &&
+            m_overlay_sy <= y && y <= m_overlay_ey && m_overlay->exist(x, y)) {
+            return static_cast<uint8_t>(m_overlay->getColor());
+        }
+        const Color col = block_map.getColor(x, y);
+        if (col != Color::BLACK) {
+            return static_cast<uint8_t>(col);
+        }
+        // Ghost preview: the overlay shifted down to its landing row
+        if (0 < m_ghost_dy && m_overlay_sy + m_ghost_dy <= y &&
+            y <= m_overlay_ey + m_ghost_dy &&
+            m_overlay_sx <= x && x <= m_overlay_ex &&
+            m_overlay->exist(x, y - m_ghost_dy)) {
+            return static_cast<uint8_t>(m_overlay->getColor()) | GHOST_BIT;
+        }
+        return static_cast<uint8_t>(Color::BLACK);
+    }
+
+    void appendCell(uint8_t code) {
+        if (code & GHOST_BIT) {
+            // Dim outline: foreground-colored shade glyphs on the default
+            // background (two half-width chars keep the cell grid aligned)
+            appendResetColor();
+            m_frame_buf += m_ghost_esc[code & ~GHOST_BIT];
+            m_frame_buf += "░░";
+        } else {
+            appendColorCode(static_cast<Color>(code));
+            m_frame_buf += "　";
+        }
+    }
+
+    // Clear, walls and the score-line prefix, precomposed once at
+    // construction; the chrome ends with the cursor after "Point: " and the
+    // terminal colors reset
+    void buildStaticChrome() {
+        m_frame_buf.clear();
+        // Clear all and go to top left
+        m_frame_buf += "\e[2J\e[1;1H";
+        // Top wall
+        moveCursorToCell(-1, -1);
+        appendWall(m_w + 2);
+        // Side walls
+        for (size_t y = 0; y < m_h; y++) {
+            moveCursorToCell(-1, y);
+            appendWall(1);
+            moveCursorToCell(m_w, y);
+            appendWall(1);
+        }
+        // Bottom wall
+        moveCursorToCell(-1, m_h);
+        appendWall(m_w + 2);
+        // Point line
+        appendResetColor();
+        appendCursorMove(1, 1);
+        m_frame_buf += "Point: ";
+        m_static_chrome = m_frame_buf;
+        m_frame_buf.clear();
+        m_curr_color = -1;
+    }
+
+    void drawFullFrame(const BlockMap& block_map, int point) {
+        // Only the point value and the cell runs are formatted per repaint
+        m_frame_buf += m_static_chrome;
+        appendInt(point);
+        for (size_t y = 0; y < m_h; y++) {
+            moveCursorToCell(0, y);
+            for (size_t x = 0; x < m_w; x++) {
+                appendCell(compositedCell(block_map, x, y));
+            }
+        }
+    }
+
+    void drawDiffFrame(const BlockMap& block_map, int point) {
+        // Point line
+        if (point != m_prev_point) {
+            appendResetColor();
+            appendCursorMove(1, 8);
+            appendInt(point);
+        }
+        // Redraw only the changed cells (walls are static). Adjacent
+        // changed cells continue the run without a cursor move, and
+        // same-color runs reuse the active color code.
+        for (size_t y = 0; y < m_h; y++) {
+            size_t run_x = m_w + 1;  // Next cell of the current run
+            for (size_t x = 0; x < m_w; x++) {
+                const uint8_t code = compositedCell(block_map, x, y);
+                if (code == m_prev_blocks[y * m_w + x]) {
+                    continue;
+                }
+                if (x != run_x) {
+                    moveCursorToCell(x, y);
+                }
+                appendCell(code);
+                run_x = x + 1;
+            }
+        }
+    }
+
+    void moveCursorToCell(int x, int y) {
+        // Field cell (0, 0) is drawn inside the walls, under the point line.
+        // One cell is two terminal columns wide.
+        appendCursorMove(y + 3, (x + 1) * 2 + 1);
+    }
+
+    void appendWall(size_t n) {
+        // White wall
+        appendColorCode(Color::WHITE);
+        for (size_t x = 0; x < n; x++) {
+            m_frame_buf += "　";
+        }
+    }
+
+    void appendColorCode(Color col) {
+        // Consecutive same-color cells share one cached code
+        if (static_cast<int>(col) == m_curr_color) {
+            return;
+        }
+        m_frame_buf += m_color_esc[static_cast<int>(col)];
+        m_curr_color = static_cast<int>(col);
+    }
+
+    void appendResetColor() {
+        m_frame_buf += "\e[0m";
+        m_curr_color = -1;
+    }
+
+    void appendCursorMove(int row, int col) {
+        m_frame_buf += "\e[";
+        appendInt(row);
+        m_frame_buf += ';';
+        appendInt(col);
+        m_frame_buf += 'H';
+    }
+
+    void appendInt(int v) {
+        // Decimal formatting without iostream (non-negative values)
+        char tmp[16];
+        int n = 0;
+        do {
+            tmp[n++] = static_cast<char>('0' + v % 10);
+            v /= 10;
+        } while (0 < v);
+        while (0 < n) {
+            m_frame_buf += tmp[--n];
+        }
+    }
+
+    void flushFrame() {
+        if (m_async_writer) {
+            if (!m_async_writer->submit(m_frame_buf)) {
+                m_first_frame = true;  // Backlog dropped: repaint from scratch
+            }
+            return;
+        }
+        // Emit the composed frame with a single write(2). The fd may be
+        // nonblocking (tetris_server's client sockets): on a short write
+        // the rest of the frame is dropped and the next draw repaints from
+        // scratch, so a stalled client costs itself a frame, never a
+        // blocked caller
+        const char* data = m_frame_buf.data();
+        size_t rest = m_frame_buf.size();
+        while (0 < rest) {
+            const ssize_t n = write(m_out_fd, data, rest);
+            if (n <= 0) {
+                m_first_frame = true;
+                break;
+            }
+            data += n;
+            rest -= n;
+        }
+    }
+
+    size_t m_w, m_h;
+    int m_out_fd;
+    std::string m_color_esc[8];  // Cached background escape per Color
+    std::string m_ghost_esc[8];  // Cached foreground escape per Color
+    int m_curr_color = -1;       // Color of the last emitted code
+    const Block* m_overlay = nullptr;
+    int m_ghost_dy = 0;
+    int m_overlay_sx = 0, m_overlay_sy = 0, m_overlay_ex = -1,
+        m_overlay_ey = -1;
+    std::vector<uint8_t> m_prev_blocks;
+    std::string m_frame_buf;
+    std::string m_static_chrome;  // Precomposed clear + walls + score prefix
+    std::unique_ptr<AsyncFrameWriter> m_async_writer;
+    int m_prev_point = -1;
+    bool m_first_frame = true;
+};
+
+#endif  // TETRIS_RENDER_H
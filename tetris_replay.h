@@ -0,0 +1,109 @@
+#ifndef TETRIS_REPLAY_H
+#define TETRIS_REPLAY_H
+
+// Compact binary replay format: a fixed header (field size + RNG seed)
+// followed by an append-only stream of timestamped inputs. Since the engine
+// is deterministic given seed and inputs, re-simulating the stream through
+// TetrisEngine reproduces the session exactly and runs as fast as the CPU
+// allows. Writes are buffered so recording adds negligible frame-loop cost.
+
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "tetris_engine.h"
+
+struct ReplayHeader {
+    char magic[4];       // "TTRP"
+    uint32_t version;    // Format version
+    uint32_t w, h;       // Field size
+    uint32_t seed;       // RandomBlockGenerator seed
+};
+
+struct ReplayEvent {
+    uint32_t time_ms;    // Milliseconds since session start
+    uint8_t input;       // static_cast<uint8_t>(Input)
+} __attribute__((packed));
+
+// v2: RandomBlockGenerator switched to seeded PCG32 + 7-bag sequences
+// v3: hard-drop input (Input::DROP) added to the event vocabulary
+constexpr uint32_t REPLAY_VERSION = 3;
+
+class ReplayWriter {
+public:
+    ReplayWriter(const std::string& path, uint32_t w, uint32_t h,
+                 uint32_t seed) {
+        m_file = std::fopen(path.c_str(), "wb");
+        if (!m_file) {
+            return;
+        }
+        // Large stdio buffer: the frame loop only memcpys into it
+        std::setvbuf(m_file, nullptr, _IOFBF, 1 << 16);
+        ReplayHeader header;
+        std::memcpy(header.magic, "TTRP", 4);
+        header.version = REPLAY_VERSION;
+        header.w = w;
+        header.h = h;
+        header.seed = seed;
+        std::fwrite(&header, sizeof(header), 1, m_file);
+    }
+
+    ~ReplayWriter() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+
+    void record(Input input, uint32_t time_ms) {
+        if (!m_file) {
+            return;
+        }
+        const ReplayEvent event = {time_ms, static_cast<uint8_t>(input)};
+        std::fwrite(&event, sizeof(event), 1, m_file);
+    }
+
+private:
+    FILE* m_file = nullptr;
+};
+
+class ReplayReader {
+public:
+    explicit ReplayReader(const std::string& path) {
+        m_file = std::fopen(path.c_str(), "rb");
+        if (!m_file) {
+            return;
+        }
+        // Dimensions are bounded so a corrupt header fails here instead of
+        // inside the engine constructor's allocation
+        if (std::fread(&m_header, sizeof(m_header), 1, m_file) != 1 ||
+            std::memcmp(m_header.magic, "TTRP", 4) != 0 ||
+            m_header.version != REPLAY_VERSION ||
+            m_header.w == 0 || MAX_FIELD_DIM < m_header.w ||
+            m_header.h == 0 || MAX_FIELD_DIM < m_header.h) {
+            std::fclose(m_file);
+            m_file = nullptr;
+        }
+    }
+
+    ~ReplayReader() {
+        if (m_file) {
+            std::fclose(m_file);
+        }
+    }
+
+    bool isOpen() const { return m_file != nullptr; }
+    const ReplayHeader& getHeader() const { return m_header; }
+
+    bool next(ReplayEvent* event) {
+        return m_file && std::fread(event, sizeof(*event), 1, m_file) == 1;
+    }
+
+private:
+    FILE* m_file = nullptr;
+    ReplayHeader m_header = {};
+};
+
+#endif  // TETRIS_REPLAY_H
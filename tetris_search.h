@@ -0,0 +1,183 @@
+#ifndef TETRIS_SEARCH_H
+#define TETRIS_SEARCH_H
+
+// Parallel placement search over the headless engine core: enumerate every
+// (rotation, column) candidate for a block, simulate the drop and line clear
+// on per-thread scratch fields, score the results and return the best move.
+// Workers are persistent and scratch buffers are reused, so a search performs
+// no per-candidate allocation.
+
+#include <atomic>
+#include <condition_variable>
+#include <functional>
+#include <limits>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "tetris_engine.h"
+
+struct Placement {
+    Block::Pose pose = {0, 0, Block::ROT0};
+    int n_erased_lines = 0;
+    double score = -std::numeric_limits<double>::infinity();
+    bool valid = false;
+};
+
+// Classic height/holes/bumpiness heuristic over the cached board features;
+// usable as-is or replaced by a caller-supplied scorer. O(w), no cell reads.
+inline double DefaultPlacementScore(const BlockMap& map, int n_erased_lines) {
+    const BlockMap::EvalFeatures f = map.evalFeatures();
+    return 0.76 * n_erased_lines - 0.51 * f.total_height - 0.36 * f.n_holes -
+           0.18 * f.bumpiness;
+}
+
+class PlacementSearcher {
+public:
+    using ScoreFunc = std::function<double(const BlockMap&, int)>;
+
+    explicit PlacementSearcher(
+        size_t n_workers = std::thread::hardware_concurrency()) {
+        if (n_workers == 0) {
+            n_workers = 1;
+        }
+        m_states.resize(n_workers);
+        for (size_t i = 0; i < n_workers; i++) {
+            m_threads.emplace_back(&PlacementSearcher::workerLoop, this, i);
+        }
+    }
+
+    ~PlacementSearcher() {
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_quit = true;
+        }
+        m_job_cv.notify_all();
+        for (auto& thread : m_threads) {
+            thread.join();
+        }
+    }
+
+    // Evaluate all (rotation, column) placements of `block` on `map` and
+    // return the best-scoring one (invalid when nothing fits).
+    Placement findBestPlacement(const BlockMap& map, const Block& block,
+                                const ScoreFunc& score = DefaultPlacementScore) {
+        // Publish the job and wake the workers
+        m_map = &map;
+        m_block = &block;
+        m_score = &score;
+        m_next_candidate.store(0);
+        m_n_done.store(0);
+        for (auto& state : m_states) {
+            state.best = Placement();
+        }
+        {
+            std::lock_guard<std::mutex> lock(m_mutex);
+            m_job_id++;
+        }
+        m_job_cv.notify_all();
+
+        // Wait for all workers and reduce their per-thread bests
+        {
+            std::unique_lock<std::mutex> lock(m_mutex);
+            m_done_cv.wait(lock, [&]() {
+                return m_n_done.load() == m_states.size();
+            });
+        }
+        Placement best;
+        for (const auto& state : m_states) {
+            if (state.best.valid &&
+                (!best.valid || best.score < state.best.score)) {
+                best = state.best;
+            }
+        }
+        return best;
+    }
+
+private:
+    struct WorkerState {
+        BlockMap scratch;            // Per-job field copy, mutated in place
+        BlockMap::PlacementUndo undo;  // Reused rollback buffers
+        Block block;                 // Mutable block copy (plain value)
+        Placement best;
+    };
+
+    void workerLoop(size_t worker_idx) {
+        WorkerState& state = m_states[worker_idx];
+        uint64_t last_job_id = 0;
+        while (true) {
+            {
+                std::unique_lock<std::mutex> lock(m_mutex);
+                m_job_cv.wait(lock, [&]() {
+                    return m_quit || m_job_id != last_job_id;
+                });
+                if (m_quit) {
+                    return;
+                }
+                last_job_id = m_job_id;
+            }
+
+            // One mutable block and one field copy per job (not per
+            // candidate): candidates are locked and rolled back in place
+            state.block = *m_block;
+            state.scratch = *m_map;
+            const int w = static_cast<int>(m_map->width());
+            const int n_candidates = 4 * w;
+            while (true) {
+                const int c = m_next_candidate.fetch_add(1);
+                if (n_candidates <= c) {
+                    break;
+                }
+                evaluateCandidate(state, c / w, c % w);
+            }
+
+            if (m_n_done.fetch_add(1) + 1 == m_states.size()) {
+                std::lock_guard<std::mutex> lock(m_mutex);
+                m_done_cv.notify_all();
+            }
+        }
+    }
+
+    void evaluateCandidate(WorkerState& state, int rot, int x) {
+        Block& block = state.block;
+        Block::Pose pose = m_block->getPose();
+        pose.x = x;
+        pose.rot = static_cast<Block::Rot>(rot);
+        block.setPose(pose);
+        if (!state.scratch.isPuttable(block)) {
+            return;
+        }
+        // Hard-drop to the landing row in O(block width)
+        pose.y += state.scratch.dropDistance(block);
+        block.setPose(pose);
+        // Lock, clear, score and roll back in place: O(piece cells + w) per
+        // candidate with no field copy and no full-board score sweep
+        const int n_erased_lines = state.scratch.placeBlock(block, state.undo);
+        const double s = (*m_score)(state.scratch, n_erased_lines);
+        state.scratch.undoPlacement(state.undo);
+        if (!state.best.valid || state.best.score < s) {
+            state.best.pose = pose;
+            state.best.n_erased_lines = n_erased_lines;
+            state.best.score = s;
+            state.best.valid = true;
+        }
+    }
+
+    std::vector<std::thread> m_threads;
+    std::vector<WorkerState> m_states;
+
+    std::mutex m_mutex;
+    std::condition_variable m_job_cv;
+    std::condition_variable m_done_cv;
+    uint64_t m_job_id = 0;
+    bool m_quit = false;
+
+    // Current job (valid while workers run)
+    const BlockMap* m_map = nullptr;
+    const Block* m_block = nullptr;
+    const ScoreFunc* m_score = nullptr;
+    std::atomic<int> m_next_candidate{0};
+    std::atomic<size_t> m_n_done{0};
+};
+
+#endif  // TETRIS_SEARCH_H
@@ -0,0 +1,310 @@
+// Multi-session server: one process hosts many independent games over a
+// Unix-domain socket (default) or TCP. A single poll(2) event loop
+// multiplexes every session's input socket and gravity deadline, so one core
+// ticks hundreds of 15 fps-class sessions. Each session's engine, renderer
+// and frame buffers are allocated once at accept time and reused for the
+// session's whole life.
+//
+// With --versus, clients are paired in accept order and multi-line clears
+// send garbage rows to the paired opponent as fixed-size POD messages (see
+// tetris_versus.h); attack delivery is an engine call plus a diff redraw,
+// with no allocation on the path.
+//
+// Build: make tetris_server
+// Usage: tetris_server [--unix PATH | --tcp PORT] [--gravity-fps FPS]
+//                      [--versus]
+// Play:  stty raw -echo; nc -U PATH; stty sane
+//
+// Clients send the usual keys (h/l/j: move, k: hard drop, space/r: rotate,
+// q: quit) and
+// receive diff-rendered frames.
+
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <sys/un.h>
+#include <unistd.h>
+
+#include <chrono>
+#include <csignal>
+#include <cstring>
+#include <iostream>
+#include <memory>
+#include <poll.h>
+#include <string>
+#include <vector>
+
+#include "tetris_engine.h"
+#include "tetris_render.h"
+#include "tetris_trace.h"
+#include "tetris_versus.h"
+
+using Clock = std::chrono::steady_clock;
+
+constexpr size_t FIELD_W = 11;
+constexpr size_t FIELD_H = 20;
+
+struct Session {
+    Session(int fd_, Clock::duration gravity_interval_)
+        : fd(fd_),
+          engine(FIELD_W, FIELD_H),
+          renderer(FIELD_W, FIELD_H, fd_),
+          gravity_interval(gravity_interval_),
+          next_tick(Clock::now() + gravity_interval_) {}
+
+    ~Session() { close(fd); }
+
+    // Returns false when the session should be closed
+    bool handleInput(char key) {
+        if (key == ' ' || key == 'r') {
+            engine.step(Input::ROTATE);
+            dirty = true;
+        }
+        if (key == 'h') {
+            engine.step(Input::LEFT);
+            dirty = true;
+        }
+        if (key == 'l') {
+            engine.step(Input::RIGHT);
+            dirty = true;
+        }
+        if (key == 'j') {
+            engine.step(Input::DOWN);
+            dirty = true;
+        }
+        if (key == 'k') {
+            engine.step(Input::DROP);
+            dirty = true;
+        }
+        if (key == 'q' || key == 3 /* Ctrl-C */) {
+            return false;
+        }
+        return !engine.isGameOver();
+    }
+
+    // Returns false once the game is over
+    bool tickIfDue(Clock::time_point now) {
+        while (next_tick <= now) {
+            engine.step(Input::TICK);
+            dirty = true;
+            next_tick += gravity_interval;
+        }
+        return !engine.isGameOver();
+    }
+
+    void draw() {
+        const BlockMap& map = engine.getBlockMap();
+        const Block& block = engine.getBlock();
+        renderer.draw(map, &block, engine.getNumErasedLines(),
+                      map.dropDistance(block));
+    }
+
+    int fd;
+    TetrisEngine engine;
+    ScreenRenderer renderer;
+    Clock::duration gravity_interval;
+    Clock::time_point next_tick;
+    bool dirty = false;  // Engine state changed since the last draw
+    // Versus mode
+    Session* peer = nullptr;
+    int n_lines_counted = 0;  // Erased-lines watermark for attack deltas
+};
+
+// Clears since the last check become an attack message for the peer
+static void SendPendingAttack(Session& session) {
+    const int n_erased = session.engine.getNumErasedLines();
+    const int delta = n_erased - session.n_lines_counted;
+    session.n_lines_counted = n_erased;
+    if (!session.peer || delta < 2) {
+        return;
+    }
+    const int n_rows = AttackRows(delta);
+    if (n_rows <= 0) {
+        return;
+    }
+    // Hole column from the sender's own RNG stream keeps it unpredictable
+    const int hole_x =
+        static_cast<int>(session.engine.getSeed() + n_erased) %
+        static_cast<int>(session.peer->engine.getBlockMap().width());
+    const VersusMsg msg = MakeAttackMsg(n_rows, hole_x);
+    ApplyVersusMsg(session.peer->engine, msg);
+    session.peer->draw();  // Paints the whole current state
+    session.peer->dirty = false;
+}
+
+int MakeUnixListener(const std::string& path) {
+    const int fd = socket(AF_UNIX, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    unlink(path.c_str());
+    struct sockaddr_un addr = {};
+    addr.sun_family = AF_UNIX;
+    std::strncpy(addr.sun_path, path.c_str(), sizeof(addr.sun_path) - 1);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+            0 ||
+        listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int MakeTcpListener(int port) {
+    const int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0) {
+        return -1;
+    }
+    const int on = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    struct sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_ANY);
+    addr.sin_port = htons(port);
+    if (bind(fd, reinterpret_cast<struct sockaddr*>(&addr), sizeof(addr)) <
+            0 ||
+        listen(fd, 16) < 0) {
+        close(fd);
+        return -1;
+    }
+    return fd;
+}
+
+int main(int argc, char** argv) {
+    std::string unix_path = "/tmp/tetris.sock";
+    int tcp_port = -1;
+    double gravity_fps = 1.0;
+    bool versus = false;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--unix" && i + 1 < argc) {
+            unix_path = argv[++i];
+        } else if (arg == "--tcp" && i + 1 < argc) {
+            tcp_port = std::atoi(argv[++i]);
+        } else if (arg == "--gravity-fps" && i + 1 < argc) {
+            gravity_fps = std::atof(argv[++i]);
+        } else if (arg == "--versus") {
+            versus = true;
+        } else {
+            std::cerr << "Usage: " << argv[0]
+                      << " [--unix PATH | --tcp PORT] [--gravity-fps FPS]"
+                      << " [--versus]" << std::endl;
+            return 1;
+        }
+    }
+
+    // A dropped client makes write(2) raise SIGPIPE; ignore and rely on the
+    // error return instead
+    signal(SIGPIPE, SIG_IGN);
+    TraceRing::instance().init(getenv("TETRIS_TRACE"));
+    signal(SIGUSR1, [](int) { TraceRing::instance().toggle(); });
+
+    const int listen_fd = (0 < tcp_port) ? MakeTcpListener(tcp_port)
+                                         : MakeUnixListener(unix_path);
+    if (listen_fd < 0) {
+        std::cerr << "Cannot create listener" << std::endl;
+        return 1;
+    }
+    if (0 < tcp_port) {
+        std::cout << "Listening on tcp port " << tcp_port << std::endl;
+    } else {
+        std::cout << "Listening on " << unix_path << std::endl;
+    }
+
+    const auto gravity_interval = std::chrono::duration_cast<Clock::duration>(
+        std::chrono::duration<double>(1.0 / gravity_fps));
+    std::vector<std::unique_ptr<Session>> sessions;
+    std::vector<struct pollfd> fds;  // Reused between iterations
+
+    while (true) {
+        // Sleep until the nearest gravity deadline or any socket activity
+        const auto now = Clock::now();
+        auto next_deadline = now + gravity_interval;
+        for (const auto& session : sessions) {
+            next_deadline = std::min(next_deadline, session->next_tick);
+        }
+        const int timeout_ms = static_cast<int>(std::max<int64_t>(
+            0, std::chrono::duration_cast<std::chrono::milliseconds>(
+                   next_deadline - now)
+                   .count()));
+
+        fds.clear();
+        fds.push_back({listen_fd, POLLIN, 0});
+        for (const auto& session : sessions) {
+            fds.push_back({session->fd, POLLIN, 0});
+        }
+        poll(fds.data(), fds.size(), timeout_ms);
+
+        // New sessions; in versus mode, pair clients in accept order
+        if (fds[0].revents & POLLIN) {
+            const int client_fd = accept(listen_fd, nullptr, nullptr);
+            if (0 <= client_fd) {
+                // Nonblocking, so one client that stops reading can never
+                // stall the shared loop: a short write drops the frame tail
+                // and the renderer repaints that session from scratch (see
+                // ScreenRenderer::flushFrame)
+                fcntl(client_fd, F_SETFL, O_NONBLOCK);
+                sessions.push_back(
+                    std::make_unique<Session>(client_fd, gravity_interval));
+                Session& session = *sessions.back();
+                if (versus) {
+                    for (auto& other : sessions) {
+                        if (other.get() != &session && !other->peer) {
+                            session.peer = other.get();
+                            other->peer = &session;
+                            break;
+                        }
+                    }
+                }
+                session.draw();
+            }
+        }
+
+        // Inputs, gravity and redraw for every session
+        const auto tick_now = Clock::now();
+        for (size_t i = 0; i < sessions.size();) {
+            Session& session = *sessions[i];
+            bool alive = true;
+
+            // The pollfd list is offset by the listener entry; on the accept
+            // iteration the new session has no entry yet
+            if (i + 1 < fds.size() && fds[i + 1].fd == session.fd &&
+                (fds[i + 1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                char keys[64];
+                const ssize_t n = read(session.fd, keys, sizeof(keys));
+                if (n <= 0) {
+                    alive = false;  // Disconnected
+                }
+                for (ssize_t k = 0; k < n && alive; k++) {
+                    alive = session.handleInput(keys[k]);
+                }
+            }
+
+            if (alive) {
+                alive = session.tickIfDue(tick_now);
+                SendPendingAttack(session);
+                // Only sessions whose state actually changed are redrawn;
+                // any key or tick wakes the whole loop and an unconditional
+                // draw here would write a frame trailer to all N clients
+                if (session.dirty) {
+                    session.draw();
+                    session.dirty = false;
+                }
+            }
+
+            if (alive) {
+                i++;
+            } else {
+                if (session.peer) {
+                    // The opponent won; their session plays on solo
+                    const char note[] = "\r\nOpponent is out - you win!\r\n";
+                    (void)!write(session.peer->fd, note, sizeof(note) - 1);
+                    session.peer->peer = nullptr;
+                }
+                sessions.erase(sessions.begin() + i);
+            }
+        }
+    }
+
+    return 0;
+}
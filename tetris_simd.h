@@ -0,0 +1,52 @@
+#ifndef TETRIS_SIMD_H
+#define TETRIS_SIMD_H
+
+// SIMD row-scan kernels over the color array. Rows are contiguous char-sized
+// cells, so "is this line filled" is an any-zero test that SSE2/NEON answer
+// 16 cells at a time; a scalar loop covers other targets and the tail.
+// The engine itself detects filled lines through its per-row fill counters
+// (see BlockMap) and no longer calls this; the kernel remains as the
+// wide-row benchmark and the stress run's independent oracle.
+
+#include <cstddef>
+#include <cstdint>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+// True when the row contains an empty (Color::BLACK == 0) cell. Takes raw
+// bytes so the header has no dependency on the engine types.
+inline bool RowHasEmptyCell(const void* row, size_t w) {
+    const uint8_t* cells = static_cast<const uint8_t*>(row);
+    size_t x = 0;
+#if defined(__SSE2__)
+    const __m128i zero = _mm_setzero_si128();
+    for (; x + 16 <= w; x += 16) {
+        const __m128i v =
+            _mm_loadu_si128(reinterpret_cast<const __m128i*>(cells + x));
+        if (_mm_movemask_epi8(_mm_cmpeq_epi8(v, zero))) {
+            return true;
+        }
+    }
+#elif defined(__ARM_NEON)
+    for (; x + 16 <= w; x += 16) {
+        const uint8x16_t v = vld1q_u8(cells + x);
+        // Any zero lane makes the minimum zero
+        if (vminvq_u8(v) == 0) {
+            return true;
+        }
+    }
+#endif
+    // Scalar fallback / tail
+    for (; x < w; x++) {
+        if (cells[x] == 0) {
+            return true;
+        }
+    }
+    return false;
+}
+
+#endif  // TETRIS_SIMD_H
@@ -0,0 +1,307 @@
+// Stress/fuzz harness for the board engine: seeded random input streams
+// drive BlockMap at maximum speed on every core, and each fast path
+// (isPuttable, putBlock, eraseFilledLines, dropDistance, the SIMD row scan)
+// is cross-checked against a plain per-cell reference implementation kept
+// here as the oracle. Reports checked states per second, so the same binary
+// doubles as a soak benchmark; independent PCG streams per worker make a
+// billions-of-states overnight sweep a matter of --seconds.
+//
+// Build: make tetris_stress
+// Usage: tetris_stress [--threads N] [--seconds S]
+
+#include <atomic>
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "tetris_engine.h"
+#include "tetris_simd.h"
+
+// ------------------------- Reference implementations ------------------------
+// The simple cell-by-cell board the optimized BlockMap replaced. Deliberately
+// naive: every rule is spelled out with explicit bounds tests.
+class RefBoard {
+public:
+    RefBoard(size_t w, size_t h) : m_w(w), m_h(h), m_cells(w * h, Color::BLACK) {}
+
+    bool isPuttable(const Block& block) const {
+        int sx, sy, ex, ey;
+        block.getRange(&sx, &sy, &ex, &ey);
+        for (int y = sy; y <= ey; y++) {
+            for (int x = sx; x <= ex; x++) {
+                if (!block.exist(x, y)) {
+                    continue;
+                }
+                if (x < 0 || static_cast<int>(m_w) <= x) {
+                    return false;
+                }
+                if (y < 0) {
+                    continue;
+                }
+                if (static_cast<int>(m_h) <= y) {
+                    return false;
+                }
+                if (m_cells[y * m_w + x] != Color::BLACK) {
+                    return false;
+                }
+            }
+        }
+        return true;
+    }
+
+    void putBlock(const Block& block) {
+        int sx, sy, ex, ey;
+        block.getRange(&sx, &sy, &ex, &ey);
+        for (int y = std::max(sy, 0); y <= ey && y < static_cast<int>(m_h);
+             y++) {
+            for (int x = std::max(sx, 0);
+                 x <= ex && x < static_cast<int>(m_w); x++) {
+                if (block.exist(x, y)) {
+                    m_cells[y * m_w + x] = block.getColor();
+                }
+            }
+        }
+    }
+
+    int eraseFilledLines() {
+        int n_erased_lines = 0;
+        for (int y = m_h - 1; 0 <= y; y--) {
+            bool filled = true;
+            for (size_t x = 0; x < m_w; x++) {
+                if (m_cells[y * m_w + x] == Color::BLACK) {
+                    filled = false;
+                    break;
+                }
+            }
+            if (!filled) {
+                continue;
+            }
+            n_erased_lines++;
+            for (int yy = y; 0 < yy; yy--) {
+                std::memcpy(&m_cells[yy * m_w], &m_cells[(yy - 1) * m_w],
+                            m_w * sizeof(Color));
+            }
+            std::memset(&m_cells[0], 0, m_w * sizeof(Color));
+            y++;  // Check the shifted-down row again
+        }
+        return n_erased_lines;
+    }
+
+    int dropDistance(const Block& block) const {
+        Block probe = block;
+        int dist = 0;
+        while (true) {
+            probe.move(0, 1);
+            if (!isPuttable(probe)) {
+                return dist;
+            }
+            dist++;
+        }
+    }
+
+    Color getColor(int x, int y) const { return m_cells[y * m_w + x]; }
+    const Color* row(int y) const { return &m_cells[y * m_w]; }
+
+private:
+    size_t m_w, m_h;
+    std::vector<Color> m_cells;
+};
+
+// ------------------------------ Stress worker -------------------------------
+struct Totals {
+    std::atomic<uint64_t> n_checks{0};
+    std::atomic<uint64_t> n_games{0};
+    std::atomic<uint64_t> n_mismatches{0};
+};
+
+// Field sizes to sweep: the standard game, a tiny board (walls and floor
+// dominate), and wide boards whose rows straddle multiple mask words
+constexpr static struct {
+    size_t w, h;
+} FIELD_SIZES[] = {{11, 20}, {5, 8}, {40, 25}, {200, 40}};
+
+static bool Mismatch(Totals& totals, const char* what, uint32_t seed) {
+    totals.n_mismatches.fetch_add(1);
+    std::fprintf(stderr, "MISMATCH %s (seed %u)\n", what, seed);
+    return false;
+}
+
+// One full game on one field size; returns false on the first mismatch
+static bool RunGame(uint32_t seed, size_t w, size_t h, Totals& totals) {
+    BlockMap map(w, h);
+    RefBoard ref(w, h);
+    RandomBlockGenerator gen(w / 2, 0, seed);
+    Pcg32 rng(seed ^ 0x5eed);
+
+    Block block = gen();
+    BlockMap::PlacementUndo undo;
+    std::vector<int> heights(w);  // Scratch for the feature oracle
+    uint64_t n_checks = 0;
+    while (true) {
+        // A burst of random moves, each validated against the oracle both
+        // when it succeeds and when it is rejected
+        const int n_moves = 1 + rng.nextBounded(8);
+        for (int i = 0; i < n_moves; i++) {
+            Block probe = block;
+            switch (rng.nextBounded(4)) {
+                case 0: probe.rotate(); break;
+                case 1: probe.move(-1, 0); break;
+                case 2: probe.move(1, 0); break;
+                case 3: probe.move(0, 1); break;
+            }
+            const bool fast = map.isPuttable(probe);
+            if (fast != ref.isPuttable(probe)) {
+                return Mismatch(totals, "isPuttable", seed);
+            }
+            if (fast) {
+                block = probe;
+            }
+            n_checks++;
+        }
+
+        // Drop-distance fast path vs stepwise descent
+        if (map.dropDistance(block) != ref.dropDistance(block)) {
+            return Mismatch(totals, "dropDistance", seed);
+        }
+        n_checks++;
+
+        // Advance gravity; lock when the block rests
+        if (TryBlockAction(block, map, &Block::move, 0, 1)) {
+            continue;
+        }
+        // placeBlock/undoPlacement roundtrip before the real lock: a
+        // corrupted rollback shows up in the cell and feature compares below
+        const int n_trial = map.placeBlock(block, undo);
+        map.undoPlacement(undo);
+
+        map.putBlock(block);
+        ref.putBlock(block);
+        // SIMD row scan vs the reference rows it is about to judge
+        for (size_t y = 0; y < h; y++) {
+            bool scalar_empty = false;
+            for (size_t x = 0; x < w; x++) {
+                if (ref.getColor(x, y) == Color::BLACK) {
+                    scalar_empty = true;
+                    break;
+                }
+            }
+            if (RowHasEmptyCell(ref.row(y), w) != scalar_empty) {
+                return Mismatch(totals, "RowHasEmptyCell", seed);
+            }
+        }
+        const int n_erased = map.eraseFilledLines();
+        if (n_erased != ref.eraseFilledLines() || n_erased != n_trial) {
+            return Mismatch(totals, "eraseFilledLines count", seed);
+        }
+        for (size_t y = 0; y < h; y++) {
+            for (size_t x = 0; x < w; x++) {
+                if (map.getColor(x, y) != ref.getColor(x, y)) {
+                    return Mismatch(totals, "field cells", seed);
+                }
+            }
+        }
+        n_checks += w * h;
+
+        // Cached evaluation features vs per-cell recomputation
+        const BlockMap::EvalFeatures fast_f = map.evalFeatures();
+        BlockMap::EvalFeatures ref_f;
+        for (size_t x = 0; x < w; x++) {
+            size_t y = 0;
+            while (y < h && ref.getColor(x, y) == Color::BLACK) {
+                y++;
+            }
+            heights[x] = static_cast<int>(h - y);
+            for (; y < h; y++) {
+                ref_f.n_holes += (ref.getColor(x, y) == Color::BLACK);
+            }
+            ref_f.total_height += heights[x];
+        }
+        for (size_t x = 0; x < w; x++) {
+            const int left = (x == 0) ? static_cast<int>(h) : heights[x - 1];
+            const int right =
+                (x == w - 1) ? static_cast<int>(h) : heights[x + 1];
+            if (0 < x) {
+                ref_f.bumpiness += std::abs(heights[x] - left);
+            }
+            ref_f.max_well_depth = std::max(
+                ref_f.max_well_depth, std::min(left, right) - heights[x]);
+        }
+        if (fast_f.total_height != ref_f.total_height ||
+            fast_f.n_holes != ref_f.n_holes ||
+            fast_f.bumpiness != ref_f.bumpiness ||
+            fast_f.max_well_depth != ref_f.max_well_depth) {
+            return Mismatch(totals, "evalFeatures", seed);
+        }
+        n_checks += w;
+
+        block = gen();
+        if (!map.isPuttable(block)) {
+            break;  // Game over
+        }
+    }
+    totals.n_checks.fetch_add(n_checks);
+    totals.n_games.fetch_add(1);
+    return true;
+}
+
+int main(int argc, char** argv) {
+    size_t n_threads = std::thread::hardware_concurrency();
+    double seconds = 5.0;
+    for (int i = 1; i < argc; i++) {
+        const std::string arg = argv[i];
+        if (arg == "--threads" && i + 1 < argc) {
+            n_threads = static_cast<size_t>(std::atoi(argv[++i]));
+        } else if (arg == "--seconds" && i + 1 < argc) {
+            seconds = std::atof(argv[++i]);
+        } else {
+            std::fprintf(stderr, "Usage: %s [--threads N] [--seconds S]\n",
+                         argv[0]);
+            return 1;
+        }
+    }
+
+    using Clock = std::chrono::steady_clock;
+    const auto deadline =
+        Clock::now() + std::chrono::duration_cast<Clock::duration>(
+                           std::chrono::duration<double>(seconds));
+
+    Totals totals;
+    std::vector<std::thread> workers;
+    for (size_t t = 0; t < n_threads; t++) {
+        workers.emplace_back([t, deadline, &totals]() {
+            // Independent seed stream per worker: worker index in the high
+            // bits, game counter below
+            uint32_t game_idx = 0;
+            while (Clock::now() < deadline) {
+                const uint32_t seed =
+                    static_cast<uint32_t>(t << 24) + game_idx++;
+                const auto& size =
+                    FIELD_SIZES[game_idx % (sizeof(FIELD_SIZES) /
+                                            sizeof(FIELD_SIZES[0]))];
+                if (!RunGame(seed, size.w, size.h, totals)) {
+                    return;  // Stop this worker on the first mismatch
+                }
+            }
+        });
+    }
+    const auto start = Clock::now();
+    for (auto& worker : workers) {
+        worker.join();
+    }
+    const double elapsed =
+        std::chrono::duration<double>(Clock::now() - start).count() + 1e-9;
+
+    const uint64_t n_checks = totals.n_checks.load();
+    const uint64_t n_mismatches = totals.n_mismatches.load();
+    std::printf("%llu games, %llu states checked on %zu threads "
+                "(%.1fM states/s), %llu mismatches\n",
+                static_cast<unsigned long long>(totals.n_games.load()),
+                static_cast<unsigned long long>(n_checks), n_threads,
+                n_checks / elapsed / 1e6,
+                static_cast<unsigned long long>(n_mismatches));
+    return n_mismatches == 0 ? 0 : 1;
+}
@@ -0,0 +1,171 @@
+#ifndef TETRIS_TRACE_H
+#define TETRIS_TRACE_H
+
+// Runtime-toggleable tracepoints on the hot functions. Each probe is a
+// scope guard behind one relaxed atomic load: disabled probes cost a load
+// and a predicted branch (and compile out entirely with -DTETRIS_NO_TRACE),
+// enabled ones timestamp the scope into a lock-free event ring in the same
+// style as the frame profiler's. Probes are selected per-point at launch
+// via TETRIS_TRACE=isPuttable,draw,... (or "all") and can be toggled live
+// with SIGUSR1, so a misbehaving session can be traced without redeploying.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstring>
+#include <vector>
+
+enum TracePoint {
+    TRACE_IS_PUTTABLE = 0,
+    TRACE_PUT_BLOCK,
+    TRACE_ERASE_LINES,
+    TRACE_TRY_ACTION,
+    TRACE_DRAW,
+    TRACE_N_POINTS
+};
+
+class TraceRing {
+public:
+    struct Event {
+        uint64_t start_ns;
+        uint32_t dur_ns;
+        uint8_t point;
+    };
+
+    static TraceRing& instance();
+
+    bool isEnabled(TracePoint point) const {
+        return (m_enabled.load(std::memory_order_relaxed) >> point) & 1u;
+    }
+
+    // Parse a probe list ("isPuttable,draw", or "all") and arm those probes
+    void init(const char* spec) {
+        if (!spec || !*spec) {
+            return;
+        }
+        uint32_t mask = 0;
+        if (std::strcmp(spec, "all") == 0) {
+            mask = (1u << TRACE_N_POINTS) - 1;
+        } else {
+            for (int p = 0; p < TRACE_N_POINTS; p++) {
+                if (std::strstr(spec, POINT_NAMES[p])) {
+                    mask |= 1u << p;
+                }
+            }
+        }
+        m_spec_mask = mask;
+        m_enabled.store(mask, std::memory_order_relaxed);
+    }
+
+    // Flip all armed probes on/off together (SIGUSR1; async-signal-safe)
+    void toggle() {
+        const uint32_t cur = m_enabled.load(std::memory_order_relaxed);
+        m_enabled.store(cur ? 0 : m_spec_mask, std::memory_order_relaxed);
+    }
+
+    void emit(TracePoint point, uint64_t start_ns, uint64_t end_ns) {
+        // Index claim makes concurrent emitters (the search workers) write
+        // distinct slots; overwrite races only happen a full lap apart
+        const uint64_t idx = m_write_idx.fetch_add(1,
+                                                   std::memory_order_relaxed);
+        Event& event = m_ring[idx & RING_MASK];
+        event.start_ns = start_ns;
+        event.dur_ns = static_cast<uint32_t>(
+            std::min<uint64_t>(end_ns - start_ns, UINT32_MAX));
+        event.point = static_cast<uint8_t>(point);
+        m_count[point].fetch_add(1, std::memory_order_relaxed);
+    }
+
+    static uint64_t now() {
+        return std::chrono::duration_cast<std::chrono::nanoseconds>(
+                   std::chrono::steady_clock::now().time_since_epoch())
+            .count();
+    }
+
+    // Per-probe hit counts plus percentiles over the retained ring window
+    void dump(FILE* out) const {
+        const uint64_t n = m_write_idx.load(std::memory_order_relaxed);
+        if (n == 0) {
+            return;
+        }
+        const size_t n_events =
+            static_cast<size_t>(std::min<uint64_t>(n, RING_SIZE));
+        std::fprintf(out, "Tracepoints (%zu events retained)\n", n_events);
+        std::vector<uint32_t> samples;
+        for (int p = 0; p < TRACE_N_POINTS; p++) {
+            const uint64_t count = m_count[p].load(std::memory_order_relaxed);
+            if (count == 0) {
+                continue;
+            }
+            samples.clear();
+            for (size_t i = 0; i < n_events; i++) {
+                if (m_ring[i].point == p) {
+                    samples.push_back(m_ring[i].dur_ns);
+                }
+            }
+            if (samples.empty()) {
+                continue;
+            }
+            std::sort(samples.begin(), samples.end());
+            std::fprintf(out,
+                         "  %-16s %10llu hits  p50 %7.2fus  p99 %7.2fus  "
+                         "max %7.2fus\n",
+                         POINT_NAMES[p],
+                         static_cast<unsigned long long>(count),
+                         samples[samples.size() / 2] / 1000.0,
+                         samples[samples.size() * 99 / 100] / 1000.0,
+                         samples.back() / 1000.0);
+        }
+    }
+
+    TraceRing() = default;
+
+private:
+    constexpr static const char* POINT_NAMES[TRACE_N_POINTS] = {
+        "isPuttable", "putBlock", "eraseFilledLines", "TryBlockAction",
+        "draw"};
+
+    constexpr static size_t RING_SIZE = 4096;  // Power of two
+    constexpr static uint64_t RING_MASK = RING_SIZE - 1;
+
+    Event m_ring[RING_SIZE] = {};
+    std::atomic<uint64_t> m_write_idx{0};
+    std::atomic<uint64_t> m_count[TRACE_N_POINTS] = {};
+    std::atomic<uint32_t> m_enabled{0};
+    uint32_t m_spec_mask = 0;
+};
+
+// One global ring as a C++17 inline variable: probes reach it without the
+// function-local-static init guard a Meyers singleton would re-check on
+// every disabled-probe hit
+inline TraceRing g_trace_ring;
+inline TraceRing& TraceRing::instance() { return g_trace_ring; }
+
+class TraceScope {
+public:
+    explicit TraceScope(TracePoint point) : m_point(point) {
+        m_start_ns =
+            TraceRing::instance().isEnabled(point) ? TraceRing::now() : 0;
+    }
+
+    ~TraceScope() {
+        if (m_start_ns != 0) {
+            TraceRing::instance().emit(m_point, m_start_ns,
+                                       TraceRing::now());
+        }
+    }
+
+private:
+    TracePoint m_point;
+    uint64_t m_start_ns;
+};
+
+#ifdef TETRIS_NO_TRACE
+#define TETRIS_TRACE_SCOPE(point)
+#else
+#define TETRIS_TRACE_SCOPE(point) TraceScope trace_scope_(point)
+#endif
+
+#endif  // TETRIS_TRACE_H
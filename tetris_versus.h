@@ -0,0 +1,46 @@
+#ifndef TETRIS_VERSUS_H
+#define TETRIS_VERSUS_H
+
+// Versus-mode wire protocol: fixed-size POD messages exchanged between two
+// engine instances - between paired sessions inside one server process, or
+// across a local socket between hosts of the two engines. Messages are
+// serialized straight from engine state with no allocation and no text
+// parsing; applying an attack is one BlockMap row rotation on the receiver.
+
+#include <cstdint>
+
+#include "tetris_engine.h"
+
+enum VersusMsgType : uint8_t {
+    VERSUS_ATTACK = 1,   // Garbage rows for the opponent
+    VERSUS_TOP_OUT = 2,  // Sender's game ended
+};
+
+struct VersusMsg {
+    uint8_t type;    // VersusMsgType
+    uint8_t n_rows;  // VERSUS_ATTACK: garbage rows to insert
+    uint8_t hole_x;  // VERSUS_ATTACK: hole column of the garbage rows
+    uint8_t pad;
+} __attribute__((packed));
+
+// Attack strength by lines cleared at once (standard rules: a single sends
+// nothing, double 1, triple 2, tetris 4)
+inline int AttackRows(int n_cleared) {
+    if (n_cleared < 2) {
+        return 0;
+    }
+    return (n_cleared == 4) ? 4 : n_cleared - 1;
+}
+
+inline VersusMsg MakeAttackMsg(int n_rows, int hole_x) {
+    return {VERSUS_ATTACK, static_cast<uint8_t>(n_rows),
+            static_cast<uint8_t>(hole_x), 0};
+}
+
+inline void ApplyVersusMsg(TetrisEngine& engine, const VersusMsg& msg) {
+    if (msg.type == VERSUS_ATTACK) {
+        engine.addGarbage(msg.n_rows, msg.hole_x);
+    }
+}
+
+#endif  // TETRIS_VERSUS_H